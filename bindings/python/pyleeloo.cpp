@@ -75,6 +75,18 @@ void (leeloo::port_list_intervals::*port_remove2)(leeloo::port const)
 
 typedef uint16_t (leeloo::port::*get_port_const)() const;
 
+template <class List>
+static void list_create_index_cache(List& l, size_t const cache_entry_size)
+{
+	l.create_index_cache(cache_entry_size);
+}
+
+template <class List>
+static size_t list_create_index_cache_auto(List& l)
+{
+	return l.create_index_cache();
+}
+
 template <class Integer>
 class set_read_only
 {
@@ -473,7 +485,8 @@ BOOST_PYTHON_MODULE(pyleeloo)
 		.def("remove", ip_remove4)
 		.def("aggregate", &leeloo::ip_list_intervals::aggregate)
 		.def("aggregate_max_prefix", &ip_list_intervals_with_properties_python::aggregate_max_prefix)
-		.def("create_index_cache", &leeloo::ip_list_intervals::create_index_cache)
+		.def("create_index_cache", &list_create_index_cache<leeloo::ip_list_intervals>)
+		.def("create_index_cache", &list_create_index_cache_auto<leeloo::ip_list_intervals>)
 		.def("size", &leeloo::ip_list_intervals::size)
 		.def("intervals_count", &leeloo::ip_list_intervals::intervals_count)
 		.def("reserve", &leeloo::ip_list_intervals::reserve)
@@ -494,7 +507,8 @@ BOOST_PYTHON_MODULE(pyleeloo)
 		.def("add", u16_add2)
 		.def("aggregate", &u16_list_intervals::aggregate)
 		.def("aggregate_max_prefix", &ip_list_intervals_with_properties_python::aggregate_max_prefix)
-		.def("create_index_cache", &u16_list_intervals::create_index_cache)
+		.def("create_index_cache", &list_create_index_cache<u16_list_intervals>)
+		.def("create_index_cache", &list_create_index_cache_auto<u16_list_intervals>)
 		.def("size", &u16_list_intervals::size)
 		.def("intervals_count", &u16_list_intervals::intervals_count)
 		.def("reserve", &u16_list_intervals::reserve)
@@ -515,7 +529,8 @@ BOOST_PYTHON_MODULE(pyleeloo)
 		.def("remove", u32_remove)
 		.def("aggregate", &u32_list_intervals::aggregate)
 		.def("aggregate_max_prefix", &ip_list_intervals_with_properties_python::aggregate_max_prefix)
-		.def("create_index_cache", &u32_list_intervals::create_index_cache)
+		.def("create_index_cache", &list_create_index_cache<u32_list_intervals>)
+		.def("create_index_cache", &list_create_index_cache_auto<u32_list_intervals>)
 		.def("size", &u32_list_intervals::size)
 		.def("intervals_count", &u32_list_intervals::intervals_count)
 		.def("reserve", &u32_list_intervals::reserve)
@@ -547,7 +562,8 @@ BOOST_PYTHON_MODULE(pyleeloo)
 		.def("aggregate_properties_no_rem", &ip_list_intervals_with_properties_python_aggregate_properties_no_rem)
 		.def("property_of", &ip_list_intervals_with_properties_python_property_of_wrapper)
 		.def("property_of", &ip_list_intervals_with_properties_python_property_of_wrapper_str)
-		.def("create_index_cache", &ip_list_intervals_with_properties_python::create_index_cache)
+		.def("create_index_cache", &list_create_index_cache<ip_list_intervals_with_properties_python>)
+		.def("create_index_cache", &list_create_index_cache_auto<ip_list_intervals_with_properties_python>)
 		.def("size", &ip_list_intervals_with_properties_python::size)
 		.def("intervals_count", &ip_list_intervals_with_properties_python::intervals_count)
 		.def("reserve", &ip_list_intervals_with_properties_python::reserve)
@@ -571,7 +587,8 @@ BOOST_PYTHON_MODULE(pyleeloo)
 		.def("remove", port_remove1)
 		.def("remove", port_remove2)
 		.def("aggregate", &leeloo::port_list_intervals::aggregate)
-		.def("create_index_cache", &leeloo::port_list_intervals::create_index_cache)
+		.def("create_index_cache", &list_create_index_cache<leeloo::port_list_intervals>)
+		.def("create_index_cache", &list_create_index_cache_auto<leeloo::port_list_intervals>)
 		.def("size", &leeloo::port_list_intervals::size)
 		.def("intervals_count", &leeloo::port_list_intervals::intervals_count)
 		.def("reserve", &leeloo::port_list_intervals::reserve)
@@ -0,0 +1,81 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <leeloo/cpu_features.h>
+
+static leeloo::cpu_features::simd_level detect_simd_level()
+{
+	using namespace leeloo::cpu_features;
+
+	__builtin_cpu_init();
+	simd_level ret = simd_scalar;
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")) {
+		ret = simd_avx512;
+	}
+	else
+	if (__builtin_cpu_supports("avx2")) {
+		ret = simd_avx2;
+	}
+	else
+	if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("ssse3")) {
+		ret = simd_sse42;
+	}
+
+	const char* const env = getenv("LEELOO_SIMD");
+	if (env != nullptr) {
+		simd_level max = ret;
+		if (strcmp(env, "scalar") == 0) {
+			max = simd_scalar;
+		}
+		else
+		if (strcmp(env, "sse4.2") == 0) {
+			max = simd_sse42;
+		}
+		else
+		if (strcmp(env, "avx2") == 0) {
+			max = simd_avx2;
+		}
+		else
+		if (strcmp(env, "avx512") == 0) {
+			max = simd_avx512;
+		}
+		ret = std::min(ret, max);
+	}
+	return ret;
+}
+
+leeloo::cpu_features::simd_level leeloo::cpu_features::level()
+{
+	static const simd_level ret = detect_simd_level();
+	return ret;
+}
@@ -28,6 +28,7 @@
 
 #include <sys/time.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <leeloo/helpers.h>
 
@@ -37,3 +38,14 @@ double leeloo::get_current_timestamp()
 	gettimeofday(&curt, NULL);
 	return (double)curt.tv_sec + ((double)curt.tv_usec)/1000000.0;
 }
+
+size_t leeloo::get_l2_cache_size()
+{
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	const long ret = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if (ret > 0) {
+		return ret;
+	}
+#endif
+	return 256*1024;
+}
@@ -447,7 +447,7 @@ private:
 namespace std {
 
 template <>
-void swap(leeloo::bit_field::bit_value& a, leeloo::bit_field::bit_value& b)
+inline void swap(leeloo::bit_field::bit_value& a, leeloo::bit_field::bit_value& b)
 {
 	const bool tmp = b;
 	b = a;
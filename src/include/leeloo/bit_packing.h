@@ -0,0 +1,160 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LEELOO_BIT_PACKING_H
+#define LEELOO_BIT_PACKING_H
+
+#include <cstdint>
+#include <cstring>
+
+#include <x86intrin.h>
+
+namespace leeloo {
+
+namespace __impl {
+
+// Bit packing of blocks of 128 32-bit integers with b bits each. The block is
+// seen as 4 lanes of 32 integers (integer i is in lane i%4), and each lane
+// is packed into b 32-bit words that are interleaved with the words of the
+// other lanes. A block thus takes 16*b bytes, and can be unpacked with one
+// SIMD register holding the current word of each lane.
+
+static constexpr size_t bit_packing_block_size = 128;
+
+inline unsigned int bit_packing_width(uint32_t const* in)
+{
+	uint32_t acc = 0;
+	for (size_t i = 0; i < bit_packing_block_size; i++) {
+		acc |= in[i];
+	}
+	return (acc == 0) ? 0 : 32 - __builtin_clz(acc);
+}
+
+inline size_t bit_packing_bytes(unsigned int const b)
+{
+	return 16*b;
+}
+
+inline void bit_pack128(uint32_t const* in, uint32_t* out, unsigned int const b)
+{
+	if (b == 0) {
+		return;
+	}
+	for (size_t lane = 0; lane < 4; lane++) {
+		uint32_t* lane_out = out + lane;
+		uint32_t cur = 0;
+		unsigned int shift = 0;
+		for (size_t k = 0; k < 32; k++) {
+			const uint32_t v = in[4*k+lane];
+			cur |= v << shift;
+			if (shift + b >= 32) {
+				*lane_out = cur;
+				lane_out += 4;
+				// Remaining high bits of v
+				cur = (shift == 0) ? 0 : (v >> (32 - shift));
+				shift = shift + b - 32;
+			}
+			else {
+				shift += b;
+			}
+		}
+	}
+}
+
+inline void bit_unpack128_scalar(uint32_t const* in, uint32_t* out, unsigned int const b)
+{
+	if (b == 0) {
+		memset(out, 0, bit_packing_block_size*sizeof(uint32_t));
+		return;
+	}
+	const uint32_t mask = (b == 32) ? 0xFFFFFFFF : ((1U << b) - 1);
+	for (size_t lane = 0; lane < 4; lane++) {
+		uint32_t const* lane_in = in + lane;
+		uint32_t cur = *lane_in;
+		unsigned int shift = 0;
+		for (size_t k = 0; k < 32; k++) {
+			uint32_t v = cur >> shift;
+			if (shift + b >= 32) {
+				if (k < 31) {
+					lane_in += 4;
+					cur = *lane_in;
+					if (shift + b > 32) {
+						v |= cur << (32 - shift);
+					}
+				}
+				shift = shift + b - 32;
+			}
+			else {
+				shift += b;
+			}
+			out[4*k+lane] = v & mask;
+		}
+	}
+}
+
+#ifdef __SSE2__
+inline void bit_unpack128(uint32_t const* in, uint32_t* out, unsigned int const b)
+{
+	if (b == 0) {
+		memset(out, 0, bit_packing_block_size*sizeof(uint32_t));
+		return;
+	}
+	const __m128i mask = _mm_set1_epi32((b == 32) ? 0xFFFFFFFF : ((1U << b) - 1));
+	__m128i const* vin = (__m128i const*) in;
+	__m128i* vout = (__m128i*) out;
+	__m128i cur = _mm_loadu_si128(vin);
+	unsigned int shift = 0;
+	for (size_t k = 0; k < 32; k++) {
+		__m128i v = _mm_srl_epi32(cur, _mm_cvtsi32_si128(shift));
+		if (shift + b >= 32) {
+			if (k < 31) {
+				cur = _mm_loadu_si128(++vin);
+				if (shift + b > 32) {
+					v = _mm_or_si128(v, _mm_sll_epi32(cur, _mm_cvtsi32_si128(32 - shift)));
+				}
+			}
+			shift = shift + b - 32;
+		}
+		else {
+			shift += b;
+		}
+		_mm_storeu_si128(vout + k, _mm_and_si128(v, mask));
+	}
+}
+#else
+inline void bit_unpack128(uint32_t const* in, uint32_t* out, unsigned int const b)
+{
+	bit_unpack128_scalar(in, out, b);
+}
+#endif
+
+} // __impl
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LEELOO_CPU_FEATURES_H
+#define LEELOO_CPU_FEATURES_H
+
+#include <leeloo/exports.h>
+
+// Compile a function for the given instruction set, whatever the -m flags of
+// the translation unit are. It must only be called after checking that the
+// CPU supports this instruction set.
+#define LEELOO_TARGET(isa) __attribute__((target(isa)))
+
+namespace leeloo {
+
+namespace cpu_features {
+
+// Instruction sets of the SIMD kernels, from the narrowest to the widest
+enum simd_level
+{
+	simd_scalar = 0,
+	// SSSE3 up to SSE4.2
+	simd_sse42,
+	simd_avx2,
+	simd_avx512
+};
+
+// Widest instruction set supported by the CPU, detected once. It can be
+// lowered with the LEELOO_SIMD environment variable (scalar, sse4.2, avx2 or
+// avx512), for instance to check the other kernels.
+extern LEELOO_API simd_level level();
+
+inline bool supports(simd_level const l)
+{
+	return level() >= l;
+}
+
+}
+
+}
+
+#endif
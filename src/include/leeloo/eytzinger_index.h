@@ -0,0 +1,303 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LEELOO_EYTZINGER_INDEX_H
+#define LEELOO_EYTZINGER_INDEX_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <x86intrin.h>
+
+#include <leeloo/cpu_features.h>
+
+namespace leeloo {
+
+namespace __impl {
+
+// Descend the tree for 8 values at once. Return false if no SIMD version is
+// available for this key type.
+template <class Key>
+inline bool eytzinger_descend8_simd(Key const* /*keys*/, size_t const /*size*/, unsigned int const /*depth*/, Key const* /*v*/, size_t* /*k*/)
+{
+	return false;
+}
+
+LEELOO_TARGET("avx2") inline bool eytzinger_descend8_avx2(uint32_t const* keys, size_t const size, unsigned int const depth, uint32_t const* v, size_t* k)
+{
+	// Positions must fit in signed 32-bit gather indexes
+	if (size >= (1U<<30)) {
+		return false;
+	}
+
+	// Unsigned comparisons are done by flipping the sign bits
+	const __m256i sign = _mm256_set1_epi32(0x80000000);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i size_p1 = _mm256_set1_epi32(size+1);
+	const __m256i vs = _mm256_xor_si256(_mm256_loadu_si256((__m256i const*) v), sign);
+	__m256i kv = one;
+	for (unsigned int level = 0; level < depth; level++) {
+		const __m256i active = _mm256_cmpgt_epi32(size_p1, kv);
+		const __m256i keys_k = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (int const*) keys, kv, active, 4);
+		const __m256i gt = _mm256_cmpgt_epi32(_mm256_xor_si256(keys_k, sign), vs);
+		// k = 2*k + (key <= v), and gt is -1 when key > v
+		const __m256i next = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(kv, 1), one), gt);
+		kv = _mm256_blendv_epi8(kv, next, active);
+	}
+
+	uint32_t kbuf[8];
+	_mm256_storeu_si256((__m256i*) kbuf, kv);
+	for (size_t l = 0; l < 8; l++) {
+		k[l] = kbuf[l];
+	}
+	return true;
+}
+
+inline bool eytzinger_descend8_simd(uint32_t const* keys, size_t const size, unsigned int const depth, uint32_t const* v, size_t* k)
+{
+	static const bool avx2 = cpu_features::supports(cpu_features::simd_avx2);
+	return avx2 && eytzinger_descend8_avx2(keys, size, depth, v, k);
+}
+
+} // __impl
+
+// Sorted keys stored in the Eytzinger (breadth-first) order of a complete
+// binary search tree, with a value attached to each key. Keys and values are
+// stored in two different arrays, so that a search only reads the keys. The
+// children of a node are next to each other, and the 16 (for 32-bit keys)
+// great-great-grandchildren of a node share a cache line, which is
+// prefetched while the search goes down.
+//
+// Positions are 1-based, and 0 means "no such key".
+template <class Key, class Value>
+class eytzinger_index
+{
+public:
+	typedef Key key_type;
+	typedef Value value_type;
+
+	static constexpr size_t cache_line_size = 64;
+	static constexpr size_t keys_per_line = cache_line_size/sizeof(key_type);
+
+public:
+	eytzinger_index():
+		_keys(nullptr),
+		_values(nullptr),
+		_size(0),
+		_depth(0)
+	{ }
+
+	eytzinger_index(eytzinger_index const& o):
+		eytzinger_index()
+	{
+		copy(o);
+	}
+
+	eytzinger_index(eytzinger_index&& o):
+		_keys(o._keys),
+		_values(o._values),
+		_size(o._size),
+		_depth(o._depth)
+	{
+		o._keys = nullptr;
+		o._values = nullptr;
+		o._size = 0;
+		o._depth = 0;
+	}
+
+	~eytzinger_index()
+	{
+		clear();
+	}
+
+public:
+	eytzinger_index& operator=(eytzinger_index const& o)
+	{
+		if (&o != this) {
+			copy(o);
+		}
+		return *this;
+	}
+
+	eytzinger_index& operator=(eytzinger_index&& o)
+	{
+		if (&o != this) {
+			clear();
+			std::swap(_keys, o._keys);
+			std::swap(_values, o._values);
+			std::swap(_size, o._size);
+			std::swap(_depth, o._depth);
+		}
+		return *this;
+	}
+
+public:
+	// fkey(i) and fvalue(i) give the i-th key (in ascending order) and its
+	// value.
+	template <class FKey, class FValue>
+	void build(size_t const n, FKey const& fkey, FValue const& fvalue)
+	{
+		clear();
+		if (n == 0) {
+			return;
+		}
+		allocate(n);
+		size_t i = 0;
+		build_rec(1, i, fkey, fvalue);
+	}
+
+	void clear()
+	{
+		free(_keys);
+		free(_values);
+		_keys = nullptr;
+		_values = nullptr;
+		_size = 0;
+		_depth = 0;
+	}
+
+	// Position of the last key that is lower or equal to v
+	inline size_t predecessor(key_type const v) const
+	{
+		const size_t k = descend(v);
+		// The predecessor is where the search went right for the last time
+		return k >> (__builtin_ctzll(k)+1);
+	}
+
+	// Position of the first key that is strictly greater than v
+	inline size_t successor(key_type const v) const
+	{
+		const size_t k = descend(v);
+		// The successor is where the search went left for the last time
+		return k >> (__builtin_ctzll(~k)+1);
+	}
+
+	// Interleaved searches of the predecessors of v[0..G[, so that the
+	// memory accesses of the different searches overlap.
+	template <size_t G>
+	void predecessors(key_type const* v, size_t* pos) const
+	{
+		size_t k[G];
+		if ((G != 8) || !__impl::eytzinger_descend8_simd(_keys, _size, _depth, v, k)) {
+			descend_interleaved<G>(v, k);
+		}
+		for (size_t l = 0; l < G; l++) {
+			pos[l] = k[l] >> (__builtin_ctzll(k[l])+1);
+		}
+	}
+
+	inline key_type key_at(size_t const pos) const { return _keys[pos]; }
+	inline value_type const& value_at(size_t const pos) const { return _values[pos]; }
+
+	inline key_type const* keys() const { return _keys; }
+	inline value_type const* values() const { return _values; }
+
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return _size == 0; }
+
+	inline size_t memory_size() const { return (_size+1)*(sizeof(key_type)+sizeof(value_type)); }
+
+private:
+	inline size_t descend(key_type const v) const
+	{
+		size_t k = 1;
+		while (k <= _size) {
+			__builtin_prefetch(_keys + k*keys_per_line);
+			k = 2*k + (_keys[k] <= v);
+		}
+		return k;
+	}
+
+	template <size_t G>
+	inline void descend_interleaved(key_type const* v, size_t* k) const
+	{
+		for (size_t l = 0; l < G; l++) {
+			k[l] = 1;
+		}
+		// All the searches have the same depth, except on the last level
+		for (unsigned int level = 0; level < _depth; level++) {
+			for (size_t l = 0; l < G; l++) {
+				const size_t kl = k[l];
+				if (kl <= _size) {
+					__builtin_prefetch(_keys + kl*keys_per_line);
+					k[l] = 2*kl + (_keys[kl] <= v[l]);
+				}
+			}
+		}
+	}
+
+	template <class FKey, class FValue>
+	void build_rec(size_t const k, size_t& i, FKey const& fkey, FValue const& fvalue)
+	{
+		if (k > _size) {
+			return;
+		}
+		build_rec(2*k, i, fkey, fvalue);
+		_keys[k] = fkey(i);
+		_values[k] = fvalue(i);
+		i++;
+		build_rec(2*k+1, i, fkey, fvalue);
+	}
+
+	void allocate(size_t const n)
+	{
+		if ((posix_memalign((void**) &_keys, cache_line_size, (n+1)*sizeof(key_type)) != 0) ||
+		    (posix_memalign((void**) &_values, cache_line_size, (n+1)*sizeof(value_type)) != 0)) {
+			free(_keys);
+			_keys = nullptr;
+			throw std::bad_alloc();
+		}
+		_size = n;
+		_depth = 64-__builtin_clzll(n);
+	}
+
+	void copy(eytzinger_index const& o)
+	{
+		clear();
+		if (o._size == 0) {
+			return;
+		}
+		allocate(o._size);
+		memcpy(_keys, o._keys, (_size+1)*sizeof(key_type));
+		memcpy(_values, o._values, (_size+1)*sizeof(value_type));
+	}
+
+private:
+	key_type* _keys;
+	value_type* _values;
+	size_t _size;
+	// Number of levels of the tree
+	unsigned int _depth;
+};
+
+}
+
+#endif
@@ -29,6 +29,8 @@
 #ifndef LEELOO_HELPERS_H
 #define LEELOO_HELPERS_H
 
+#include <cstddef>
+
 #include <leeloo/exports.h>
 
 namespace leeloo {
@@ -36,6 +38,10 @@ namespace leeloo {
 // Get current timestamp in seconds
 extern LEELOO_API double get_current_timestamp();
 
+// Get the size in bytes of the L2 cache of the current CPU, or a sensible
+// default if it can't be known
+extern LEELOO_API size_t get_l2_cache_size();
+
 }
 
 #endif
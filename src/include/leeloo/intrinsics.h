@@ -31,9 +31,9 @@
 
 #include <x86intrin.h>
 
-#ifdef __SSE4_2__
+#include <leeloo/cpu_features.h>
 
-inline static __m128i _mm_urem_epi32(__m128i const a, __m128i const div)
+LEELOO_TARGET("sse4.2") inline static __m128i _mm_urem_epi32(__m128i const a, __m128i const div)
 {
 #ifdef __AVX__
 	const __m256d a_dble = _mm256_cvtepi32_pd(a);
@@ -51,7 +51,7 @@ inline static __m128i _mm_urem_epi32(__m128i const a, __m128i const div)
 #endif
 }
 
-inline static __m128i _mm_mulmod_epu32(__m128i const a, __m128i const b, uint64_t const m)
+LEELOO_TARGET("sse4.2") inline static __m128i _mm_mulmod_epu32(__m128i const a, __m128i const b, uint64_t const m)
 {
 	uint64_t tmp0, tmp1;
 #define LEELOO__MUL__(resi, a_, b_)\
@@ -71,7 +71,7 @@ inline static __m128i _mm_mulmod_epu32(__m128i const a, __m128i const b, uint64_
 			_mm_shuffle_epi32(res1, 2 << 2));
 }
 
-inline static __m128i _mm_mulmodadd_epu32(__m128i const a, __m128i const b, __m128i const c, uint64_t const m)
+LEELOO_TARGET("sse4.2") inline static __m128i _mm_mulmodadd_epu32(__m128i const a, __m128i const b, __m128i const c, uint64_t const m)
 {
 	uint64_t tmp0, tmp1;
 #define LEELOO__MULADD__(resi, a_, b_)\
@@ -92,5 +92,3 @@ inline static __m128i _mm_mulmodadd_epu32(__m128i const a, __m128i const b, __m1
 }
 
 #endif
-
-#endif
@@ -30,6 +30,8 @@
 #define LEELO_IP_LIST_INTERVALS_H
 
 #include <cstdint>
+#include <vector>
+
 #include <leeloo/interval.h>
 #include <leeloo/list_intervals.h>
 
@@ -48,6 +50,12 @@ public:
 	bool add(const char* str_interval);
 	bool remove(const char* str_interval);
 
+	// Parse the IP ranges of buf[0..len[, separated by sep, in parallel.
+	// Return the offsets in buf of the ranges that couldn't be parsed, in
+	// ascending order.
+	std::vector<size_t> add_many(const char* buf, size_t const len, char const sep = '\n');
+	std::vector<size_t> remove_many(const char* buf, size_t const len, char const sep = '\n');
+
 	template <bool exclude = false>
 	inline void insert(typename std::enable_if<exclude == true, const char*>::type str_interval)
 	{
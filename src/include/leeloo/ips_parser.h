@@ -46,8 +46,17 @@ typedef void(*interval_callback)(uint32_t a, uint32_t b);
 extern LEELOO_API uint32_t ipv4toi(const char* str, bool& valid, int min_dots = 3);
 extern LEELOO_API uint32_t ipv4toi(const char* str, const size_t size, bool& valid, int min_dots = 3);
 
+// Parse the newline-separated IPs of buf[0..size[, up to n of them. The IP of
+// the i-th line is stored in ips[i], and valid[i] tells whether it could be
+// parsed. Return the number of parsed lines, and set *consumed to the number
+// of bytes they used (including their new lines).
+extern LEELOO_API size_t ipv4toi_batch(const char* buf, const size_t size, uint32_t* ips, uint8_t* valid, const size_t n, size_t* consumed = nullptr);
+
 extern LEELOO_API bool parse_ips_add(ip_list_intervals& l, const char* str);
 extern LEELOO_API bool parse_ips_remove(ip_list_intervals& l, const char* str);
+// Same as above, with str[0..size[ which doesn't need to be null-terminated
+extern LEELOO_API bool parse_ips_add(ip_list_intervals& l, const char* str, const size_t size);
+extern LEELOO_API bool parse_ips_remove(ip_list_intervals& l, const char* str, const size_t size);
 
 template <bool exclude = false>
 inline bool parse_ips(typename std::enable_if<exclude == true, ip_list_intervals&>::type l, const char* str)
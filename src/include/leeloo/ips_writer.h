@@ -0,0 +1,65 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LEELO_IPS_WRITER_H
+#define LEELO_IPS_WRITER_H
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <leeloo/exports.h>
+
+namespace leeloo {
+
+class ip_list_intervals;
+
+namespace ips_writer {
+
+// Write the intervals of l to fd, one per line. write_cidr() decomposes
+// each interval into its minimal set of CIDR blocks (like 10.0.0.0/24),
+// and write_ranges() writes them as inclusive ranges (like
+// 10.0.0.0-10.0.0.255), or as single IPs. Lines are formatted in a large
+// buffer that is flushed with write(). Throw file_exception on error.
+extern LEELOO_API void write_cidr(int fd, ip_list_intervals const& l);
+extern LEELOO_API void write_ranges(int fd, ip_list_intervals const& l);
+
+// Historical output of leeloo-aggregate, kept for the scripts that parse it:
+// intervals whose width is a power of two are written as lower/prefix (even
+// if lower isn't aligned on this width, which isn't a valid CIDR block), and
+// the others as lower-upper, where upper is excluded.
+extern LEELOO_API void write_legacy(int fd, ip_list_intervals const& l);
+
+// Format ip in str, which must have room for 16 characters, and return the
+// number of characters written (without null terminator).
+extern LEELOO_API size_t itoipv4(uint32_t const ip, char* str);
+
+}
+
+}
+
+#endif
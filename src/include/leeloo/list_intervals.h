@@ -29,6 +29,8 @@
 #ifndef LEELOO_INTERVAL_LIST_H
 #define LEELOO_INTERVAL_LIST_H
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
 #include <errno.h>
@@ -39,15 +41,20 @@
 
 #include <exception>
 #include <iterator>
+#include <limits>
 #include <iostream>
 #include <vector>
 
 #include <leeloo/bench.h>
+#include <leeloo/bit_field.h>
+#include <leeloo/bit_packing.h>
 #include <leeloo/config.h>
 #include <leeloo/exports.h>
+#include <leeloo/eytzinger_index.h>
 #include <leeloo/uni.h>
 #include <leeloo/utility.h>
 #include <leeloo/integer_cast.h>
+#include <leeloo/list_intervals_format.h>
 
 #ifdef LEELOO_BOOST_SERIALIZE
 #include <boost/serialization/vector.hpp>
@@ -87,6 +94,47 @@ private:
 	const char* _msg;
 };
 
+namespace __impl {
+
+// Predicates used by list_intervals::set_operation. They tell whether a value
+// is in the result according to its presence in the two operands.
+
+struct set_union_op
+{
+	static inline bool in(bool const a, bool const b) { return a || b; }
+};
+
+struct set_intersection_op
+{
+	static inline bool in(bool const a, bool const b) { return a && b; }
+};
+
+struct set_difference_op
+{
+	static inline bool in(bool const a, bool const b) { return a && !b; }
+};
+
+struct set_symmetric_difference_op
+{
+	static inline bool in(bool const a, bool const b) { return a != b; }
+};
+
+} // __impl
+
+template <class ListIntervals>
+class list_intervals_view;
+
+// How create_index_cache() chooses the size of the cache entries:
+// - l2_size: from the number of intervals, so that the cache fits in half of
+//   the L2 cache. The widths of the intervals aren't used.
+// - probe: same, then entry sizes around this one are timed on random
+//   lookups and the fastest one is kept.
+enum class index_cache_tuning
+{
+	l2_size,
+	probe
+};
+
 template <class Interval, class SizeType = uint32_t>
 class list_intervals 
 {
@@ -99,6 +147,24 @@ public:
 
 	static constexpr unsigned int interger_bits = sizeof(base_type)*CHAR_BIT;
 
+	// Number of intervals merged by a single task during aggregation
+	static constexpr size_t merge_chunk_size = 1<<16;
+	// Number of interleaved searches done by contains_batch
+	static constexpr size_t contains_batch_group = 8;
+	// Maximum number of intervals in a frame of the stream format
+	static constexpr size_t stream_frame_size = 1<<16;
+	// Number of 32-bit halves of a base_type value in the compressed format
+	static constexpr size_t compressed_halves = (sizeof(base_type)+3)/4;
+	// Size of the chunks written by dump_compressed_stream
+	static constexpr size_t compressed_write_buffer_size = 1<<16;
+	// Number of interleaved lookups done by at_cached_batch
+	static constexpr size_t at_batch_group = 8;
+	// at_cached_batch walks forward through the intervals when at most one
+	// rank out of at_batch_sorted_ratio is lower than the previous one, and
+	// searches again after at_batch_max_walk intervals.
+	static constexpr size_t at_batch_sorted_ratio = 16;
+	static constexpr size_t at_batch_max_walk = 16;
+
 private:
 	struct cmp_f
 	{
@@ -111,6 +177,7 @@ private:
 public:
 	typedef std::vector<interval_type> container_type;
 	typedef typename container_type::const_iterator iterator;
+	typedef list_intervals_view<this_type> view_type;
 
 private:
 	struct tag_vi_end
@@ -181,18 +248,23 @@ public:
 
 public:
 	list_intervals():
-		_cache_entry_size(0)
-	{ }
+		_cache_entry_size(0),
+		_aggregated_count(0)
+	{
+		reset_stats();
+	}
 
 public:
 	inline void add(base_type const a, base_type const b)
 	{
 		intervals().emplace_back(a, b);
+		update_stats(intervals().back().width());
 	}
 
 	inline void add(interval_type const& i)
 	{
 		intervals().push_back(i);
+		update_stats(i.width());
 	}
 
 	inline void remove(base_type const a, base_type const b)
@@ -213,6 +285,11 @@ public:
 		// limitation of std::*.
 		intervals().reserve(intervals().size() + o.intervals().size());
 		intervals().insert(intervals().end(), o.intervals().begin(), o.intervals().end());
+		if (o.intervals_count() > 0) {
+			_size += o.size();
+			_min_width = std::min(_min_width, o.min_interval_width());
+			_max_width = std::max(_max_width, o.max_interval_width());
+		}
 	}
 
 	inline void remove(list_intervals const& o)
@@ -222,6 +299,25 @@ public:
 		removed_intervals().insert(removed_intervals().end(), o.intervals().begin(), o.intervals().end());
 	}
 
+	// Add (or remove) the intervals of several lists, with a single
+	// reservation and a parallel copy.
+	void add_lists(std::vector<list_intervals const*> const& lists)
+	{
+		concat_lists(intervals(), lists);
+		for (list_intervals const* o: lists) {
+			if (o->intervals_count() > 0) {
+				_size += o->size();
+				_min_width = std::min(_min_width, o->min_interval_width());
+				_max_width = std::max(_max_width, o->max_interval_width());
+			}
+		}
+	}
+
+	void remove_lists(std::vector<list_intervals const*> const& lists)
+	{
+		concat_lists(removed_intervals(), lists);
+	}
+
 	template <bool exclude = false>
 	inline void insert(typename std::enable_if<exclude == true, interval_type const&>::type i)
 	{
@@ -246,10 +342,22 @@ public:
 		add(a, b);
 	}
 
+	// The intervals that were already aggregated by a previous call are kept
+	// as is. Only the intervals added since then (and the removed ones) are
+	// sorted, and then linearly merged with the aggregated ones.
 	void aggregate()
 	{
+		if (is_aggregated()) {
+			return;
+		}
+
+		_search_index.clear();
+		_rank_index.clear();
+		clear_index_cache();
+
 		if (removed_intervals().size() == 0) {
-			aggregate_container(intervals());
+			aggregate_intervals();
+			compute_stats();
 			return;
 		}
 
@@ -258,34 +366,20 @@ public:
 		}
 
 		aggregate_container(removed_intervals());
+		aggregate_intervals();
 
-		tbb::parallel_sort(intervals().begin(), intervals().end(), cmp_f());
-
-		container_type ret;
-		interval_type cur_merge = intervals().front();
-		typename container_type::const_iterator it_removed = removed_intervals().begin();
-
-		typename container_type::const_iterator it = intervals().begin()+1;
-
-		for (; it != intervals().end(); it++) {
-			interval_type const& cur_int = *it;
-			if (utility::overlap(cur_merge, cur_int)) {
-				cur_merge = utility::hull(cur_merge, cur_int);
-			}
-			else {
-				// split 'cur_merge' according to removed_intervals
-				split_merged_interval_removed(cur_merge, ret, it_removed);
-				cur_merge = cur_int;
-			}
-		}
-
-		// Now, merge the removed intervals, and do the final merge
-		split_merged_interval_removed(cur_merge, ret, it_removed);
+		// Split the merged intervals according to removed_intervals, in place
+		subtract_removed_intervals();
+		_aggregated_count = intervals().size();
+		compute_stats();
 
 		// Clear the removed intervals
 		removed_intervals().clear();
+	}
 
-		intervals() = std::move(ret);
+	inline bool is_aggregated() const
+	{
+		return (removed_intervals().size() == 0) && (_aggregated_count == intervals().size());
 	}
 
 	inline void aggregate_max_prefix(unsigned int const min_prefix)
@@ -306,19 +400,16 @@ public:
 		return (base_type(1)<<(interger_bits-prefix))-1;
 	}
 
-	base_type size() const
-	{
-		base_type ret(0);
-		for (interval_type const& i: intervals()) {
-			ret += i.width();
-		}
-		return ret;
-	}
+	// Sum of the widths of the intervals. This is the number of values of
+	// the list once it is aggregated.
+	inline base_type size() const { return _size; }
 
-	size_t intervals_count() const
-	{
-		return intervals().size();
-	}
+	inline size_t intervals_count() const { return intervals().size(); }
+
+	// Widths of the smallest and biggest intervals, or 0 if the list is
+	// empty
+	inline base_type min_interval_width() const { return intervals().empty() ? 0 : _min_width; }
+	inline base_type max_interval_width() const { return _max_width; }
 
 	template <template <class T_, bool atomic_> class UPRNG, class Fset, class RandEngine>
 	void random_sets(size_type size_div, Fset const& fset, RandEngine const& rand_eng) const
@@ -339,16 +430,18 @@ public:
 		const size_type size_all_full = strict_integer_cast<size_type>(size_all/base_type(size_div))*size_div;
 		for (size_type i = 0; i < size_all_full; i += size_div) {
 			for (size_t j = 0; j < size_div; j++) {
-				interval_buf[j] = at_cached(uprng());
+				interval_buf[j] = uprng();
 			}
+			at_cached_batch(interval_buf, interval_buf, size_div);
 			fset(interval_buf, size_div);
 		}
 
 		const size_type rem = integer_cast<size_type>(size_all-base_type(size_all_full));
 		if (rem > 0) {
 			for (size_type i = size_all_full; i < size_all; i++) {
-				interval_buf[i-size_all_full] = at_cached(uprng());
+				interval_buf[i-size_all_full] = uprng();
 			}
+			at_cached_batch(interval_buf, interval_buf, rem);
 			fset(interval_buf, rem);
 		}
 
@@ -379,8 +472,9 @@ public:
 				break;
 			}
 			for (size_type j = 0; j < size; j++) {
-				interval_buf[j] = at_cached(uprng());
+				interval_buf[j] = uprng();
 			}
+			at_cached_batch(interval_buf, interval_buf, size);
 			fset(interval_buf, size);
 
 			i++;
@@ -403,25 +497,48 @@ public:
 	}
 
 	inline void reserve(size_type n) { intervals().reserve(n); }
-	inline void clear() { intervals().clear(); removed_intervals().clear(); }
+	inline void clear() { intervals().clear(); removed_intervals().clear(); _aggregated_count = 0; _search_index.clear(); _rank_index.clear(); clear_index_cache(); reset_stats(); }
 
 	inline container_type const& intervals() const { return _intervals; }
 
 	inline base_type at(size_type const r) const
 	{
+		if (has_rank_index()) {
+			return at_rank_index(r);
+		}
 		assert(r < size());
 		return get_rth_value(r, 0, intervals().size());
 	}
 
 	base_type at_cached(base_type const r) const
 	{
+		if (has_rank_index()) {
+			return at_rank_index(r);
+		}
 		assert(r < size() && _cache_entry_size > 0);
-		ssize_t cur;
-		const size_t interval_idx = get_cached_interval_idx(r, cur);
-		if (cur == 0) {
-			return intervals()[interval_idx].lower();
+		return at_index_cache(r);
+	}
+
+	// out[i] = at_cached(ranks[i]), for i in [0,n[. out can be ranks. The
+	// lookups are interleaved to hide memory latency, and nearly sorted
+	// ranks are processed by walking forward through the intervals.
+	void at_cached_batch(base_type const* ranks, base_type* out, size_t const n) const
+	{
+		assert(has_rank_index() || _cache_entry_size > 0);
+		if (n == 0) {
+			return;
+		}
+
+		size_t ndesc = 0;
+		for (size_t i = 1; i < n; i++) {
+			ndesc += (ranks[i] < ranks[i-1]);
+		}
+		if (ndesc*at_batch_sorted_ratio <= n) {
+			at_cached_batch_forward(ranks, out, n);
+		}
+		else {
+			at_cached_batch_interleaved(ranks, out, n);
 		}
-		return get_rth_value(cur, interval_idx, intervals().size());
 	}
 
 	// cache_entry_size defines the number of intervals that represent a cache entry
@@ -442,6 +559,86 @@ public:
 		}
 	}
 
+	// Create the index cache with an entry size chosen according to tuning
+	// (see index_cache_tuning). Returns the chosen entry size.
+	// index_cache_memory_size() gives the memory used by the cache.
+	size_t create_index_cache(index_cache_tuning const tuning = index_cache_tuning::l2_size)
+	{
+		const size_t intervals_count = intervals().size();
+		size_t entry_size = default_index_cache_entry_size(intervals_count);
+
+		if ((tuning == index_cache_tuning::probe) && (intervals_count > entry_size)) {
+			const base_type size_all = size();
+			static constexpr size_t nprobes = 1<<14;
+			double best_time = std::numeric_limits<double>::max();
+			size_t best_entry_size = entry_size;
+			for (size_t e = std::max((size_t)1, entry_size/4); e <= 4*entry_size; e *= 2) {
+				create_index_cache(e);
+				// xorshift ranks, to avoid any dependency on a random engine
+				uint64_t x = 88172645463325252ULL;
+				base_type sink(0);
+				const double start = get_current_timestamp();
+				for (size_t i = 0; i < nprobes; i++) {
+					x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+					sink ^= at_index_cache(x % size_all);
+				}
+				const double time = get_current_timestamp()-start;
+				// Keep the results alive
+				__asm__ __volatile__ ("" : : "r"(sink));
+				if (time < best_time) {
+					best_time = time;
+					best_entry_size = e;
+				}
+			}
+			entry_size = best_entry_size;
+		}
+
+		create_index_cache(entry_size);
+		return entry_size;
+	}
+
+	// Entry size of the index cache for which the cache of a list of
+	// intervals_count intervals fits in half of the L2 cache
+	static size_t default_index_cache_entry_size(size_t const intervals_count)
+	{
+		const size_t l2_budget = get_l2_cache_size()/2;
+
+		// Linear scans of at least a cache line of intervals are almost free
+		// compared to a cache miss in the binary search.
+		size_t entry_size = std::max((size_t)1, (size_t)(64/sizeof(interval_type)));
+		while ((entry_size < intervals_count) && ((intervals_count/entry_size)*sizeof(size_type) > l2_budget)) {
+			entry_size *= 2;
+		}
+		return entry_size;
+	}
+
+	inline size_t index_cache_entry_size() const { return _cache_entry_size; }
+	inline size_t index_cache_memory_size() const { return _index_cache.size()*sizeof(size_type); }
+
+	// Build a frozen rank index used by at() and at_cached(). It holds the
+	// number of values before each interval in Eytzinger order, with the
+	// index of the interval, so that a rank is found in O(log n). The list
+	// must be aggregated, and the index is dropped by the next aggregate()
+	// that changes the list.
+	void create_rank_index()
+	{
+		assert(is_aggregated());
+		container_type const& ints = intervals();
+		std::vector<base_type> ranks;
+		ranks.resize(ints.size());
+		base_type cur_size(0);
+		for (size_t i = 0; i < ints.size(); i++) {
+			ranks[i] = cur_size;
+			cur_size += ints[i].width();
+		}
+		_rank_index.build(ints.size(),
+			[&ranks](size_t const i) { return ranks[i]; },
+			[](size_t const i) { return integer_cast<size_type>(i); });
+	}
+
+	inline bool has_rank_index() const { return !_rank_index.empty(); }
+	inline void clear_rank_index() { _rank_index.clear(); }
+
 	bool operator==(this_type const& o) const
 	{
 		if (_intervals.size() != o._intervals.size()) {
@@ -463,8 +660,100 @@ public:
 		return !operator==(o);
 	}
 
+	// Computes the set operation Op (see __impl::set_*_op) between two
+	// aggregated lists, in one linear pass over both of them. The result is
+	// aggregated. If parallel is true, the domain is cut into chunks that are
+	// processed by different tasks.
+	template <class Op, bool parallel = false>
+	static this_type set_operation(this_type const& a, this_type const& b)
+	{
+		assert(a.is_aggregated() && b.is_aggregated());
+
+		container_type const& ints_a = a.intervals();
+		container_type const& ints_b = b.intervals();
+		const size_t na = ints_a.size();
+		const size_t nb = ints_b.size();
+
+		this_type ret;
+		container_type& ints_ret = ret.intervals();
+		if (!parallel || ((na+nb) < 2*merge_chunk_size)) {
+			ints_ret.reserve(std::max(na, nb));
+			set_operation_sweep<Op>(ints_a.data(), na, ints_b.data(), nb, 0, 0, false,
+				[&ints_ret](interval_type const& it) { append_merge(ints_ret, it); });
+			ret._aggregated_count = ints_ret.size();
+			ret.compute_stats();
+			return ret;
+		}
+
+		// Cut the domain according to the lower bounds of the biggest list,
+		// and compute the intervals of both lists that intersect each chunk.
+		container_type const& ints_cut = (na >= nb) ? ints_a : ints_b;
+		const size_t nchunks = (na+nb)/merge_chunk_size;
+		std::vector<base_type> cuts(nchunks+1);
+		std::vector<size_t> starts_a(nchunks+1), starts_b(nchunks+1);
+		std::vector<size_t> ends_a(nchunks+1), ends_b(nchunks+1);
+		for (size_t c = 0; c < nchunks; c++) {
+			const base_type x = (c == 0) ? 0 : ints_cut[(c*ints_cut.size())/nchunks].lower();
+			cuts[c] = x;
+			starts_a[c] = first_upper_above(ints_a, x);
+			starts_b[c] = first_upper_above(ints_b, x);
+			ends_a[c] = first_lower_above(ints_a, x);
+			ends_b[c] = first_lower_above(ints_b, x);
+		}
+		ends_a[nchunks] = na;
+		ends_b[nchunks] = nb;
+
+		std::vector<container_type> chunks_ret(nchunks);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, nchunks, 1),
+			[&](tbb::blocked_range<size_t> const& r)
+			{
+				for (size_t c = r.begin(); c != r.end(); c++) {
+					container_type& chunk_ret = chunks_ret[c];
+					const bool last = (c == nchunks-1);
+					set_operation_sweep<Op>(ints_a.data()+starts_a[c], ends_a[c+1]-starts_a[c],
+					                        ints_b.data()+starts_b[c], ends_b[c+1]-starts_b[c],
+					                        cuts[c], last ? 0 : cuts[c+1], !last,
+						[&chunk_ret](interval_type const& it) { append_merge(chunk_ret, it); });
+				}
+			});
+
+		size_t size_ret = 0;
+		for (container_type const& chunk_ret: chunks_ret) {
+			size_ret += chunk_ret.size();
+		}
+		ints_ret.reserve(size_ret);
+		for (container_type const& chunk_ret: chunks_ret) {
+			for (interval_type const& it: chunk_ret) {
+				append_merge(ints_ret, it);
+			}
+		}
+		ret._aggregated_count = ints_ret.size();
+		ret.compute_stats();
+		return ret;
+	}
+
+	// Build a frozen search index used by contains(). It holds the lower
+	// bounds of the intervals in Eytzinger order, and the upper bounds in a
+	// separate array. The list must be aggregated, and the index is dropped
+	// by the next aggregate() that changes the list.
+	void create_search_index()
+	{
+		assert(is_aggregated());
+		_search_index.build(intervals().size(),
+			[this](size_t const i) { return intervals()[i].lower(); },
+			[this](size_t const i) { return intervals()[i].upper(); });
+	}
+
+	inline bool has_search_index() const { return !_search_index.empty(); }
+	inline void clear_search_index() { _search_index.clear(); }
+
 	bool contains(base_type const v) const
 	{
+		if (has_search_index()) {
+			const size_t pos = _search_index.predecessor(v);
+			return (pos != 0) && (v < _search_index.value_at(pos));
+		}
+
 		// Suppose that intervals have been aggregated! (and are thus sorted)
 		size_type a(0);
 		size_type b = intervals().size(); 
@@ -492,54 +781,189 @@ public:
 		return false;
 	}
 
-	/*
+	// Set out[i] to 1 if values[i] is in the list, and 0 otherwise. The
+	// list must be aggregated. Searches are interleaved to hide memory
+	// latency, and sorted inputs are merged linearly with the intervals.
+	void contains_batch(base_type const* values, size_t const n, uint8_t* out) const
+	{
+		contains_batch_impl(values, n, [out](size_t const i, bool const in) { out[i] = in; });
+	}
+
+	void contains_batch(base_type const* values, size_t const n, bit_field& out) const
+	{
+		out.reserve(n);
+		contains_batch_impl(values, n,
+			[&out](size_t const i, bool const in)
+			{
+				if (in) {
+					out.set_bit_fast(i);
+				}
+				else {
+					out.clear_bit_fast(i);
+				}
+			});
+	}
+
+	// Split the (aggregated) list into n lists with the same number of
+	// values, give or take one. Intervals are split at the boundaries. Cut
+	// points are found with the rank index if it exists, and by a single
+	// walk through the intervals otherwise.
 	std::vector<this_type> divide_by(size_type const n) const
 	{
 		std::vector<this_type> ret;
-		const base_type whole_size = size();
-		const size_type values_per_obj = strict_integer_cast<size_type>((whole_size+n-1)/n);
+		for (view_type const& view: divide_by_views(n)) {
+			ret.emplace_back();
+			this_type& part = ret.back();
+			part.reserve(view.intervals_count());
+			for (interval_type const& it: view) {
+				part.add(it);
+			}
+			part._aggregated_count = part.intervals_count();
+		}
+		return ret;
+	}
 
-		ret.resize(n);
-		std::vector<this_type>::iterator cur_obj;
-		size_type cur_count = 0;
+	// Same as divide_by, but the parts are views that refer to the
+	// intervals of this list, which must outlive them and not be modified.
+	std::vector<view_type> divide_by_views(size_type const n) const
+	{
+		assert(is_aggregated());
+		std::vector<view_type> ret;
+		if (n == 0) {
+			return ret;
+		}
+		ret.reserve(n);
 
-		for (interval_type const& it: intervals()) {
-			cur_count += it.size();
-			if (cur_count < values_per_obj) {
-				cur_obj->add(it);
+		container_type const& ints = intervals();
+		const base_type whole_size = size();
+		const base_type part_size = whole_size/n;
+		const base_type part_rem = whole_size%n;
+
+		// Walking position, used when there is no rank index
+		size_t idx = 0;
+		base_type start(0);
+		size_t first = 0;
+		base_type first_offset(0);
+		base_type cut(0);
+		for (size_type k = 0; k < n; k++) {
+			const base_type cur_size = part_size + ((k < part_rem) ? 1 : 0);
+			cut += cur_size;
+			size_t last;
+			base_type last_offset;
+			if (cut >= whole_size) {
+				last = ints.size();
+				last_offset = 0;
 			}
 			else {
-				const size_t above = cur_count - values_per_obj;
-				cur_obj->add(interval_type(it.lower(), it.lower()+above));
-
-				++cur_obj;
-				if (cur_obj == ret.end()) {
-					return ret;
+				if (has_rank_index()) {
+					idx = locate_rank(cut, start);
 				}
-				interval_type rem(interval_type(it.lower()+above, it.upper());
-				cur_obj.add(rem);
-				cur_count = rem.size();
+				while ((cut - start) >= ints[idx].width()) {
+					start += ints[idx].width();
+					idx++;
+				}
+				last = idx;
+				last_offset = cut - start;
+			}
+
+			// [first+first_offset, last+last_offset[
+			if ((first == last) && (first_offset == last_offset)) {
+				ret.emplace_back(*this, first, first, 0, 0, 0);
+			}
+			else
+			if (last_offset == 0) {
+				ret.emplace_back(*this, first, last, ints[first].lower() + first_offset, ints[last-1].upper(), cur_size);
 			}
+			else {
+				ret.emplace_back(*this, first, last+1, ints[first].lower() + first_offset, ints[last].lower() + last_offset, cur_size);
+			}
+			first = last;
+			first_offset = last_offset;
 		}
 		return ret;
-
-	}*/
+	}
 
 public:
-	void read_stream(std::istream& os)
+	// Read a list written in the framed stream format described in
+	// list_intervals_format.h.
+	void read_stream(std::istream& is)
 	{
-		uint32_t nintervals;
-		os >> nintervals;
 		clear();
-		intervals().resize(nintervals);
-		os.read((char*) &intervals()[0], nintervals*sizeof(interval_type));
+		read_stream_header(is);
+		try {
+			size_t n;
+			while ((n = read_stream_frame_size(is)) > 0) {
+				const size_t cur = intervals().size();
+				intervals().resize(cur + n);
+				read_stream_frame(is, &intervals()[cur], n);
+			}
+		}
+		catch (...) {
+			clear();
+			throw;
+		}
+		compute_stats();
+	}
+
+	// Read a stream written in the framed stream format and call f(ints, n)
+	// for each frame of n intervals, without keeping the previous ones in
+	// memory.
+	template <class F>
+	static void read_stream_chunks(std::istream& is, F const& f)
+	{
+		read_stream_header(is);
+		container_type buf;
+		size_t n;
+		while ((n = read_stream_frame_size(is)) > 0) {
+			buf.resize(n);
+			read_stream_frame(is, &buf[0], n);
+			f((interval_type const*) &buf[0], n);
+		}
+	}
+
+	void dump_stream(std::ostream& os) const
+	{
+		dump_stream_header(os);
+		dump_stream_chunk(os, intervals().data(), intervals().size());
+		dump_stream_end(os);
+	}
+
+	// Building blocks of dump_stream, for writers that produce the intervals
+	// chunk by chunk. A stream is made of a header, of any number of chunks
+	// and of an end mark.
+	static void dump_stream_header(std::ostream& os)
+	{
+		list_intervals_stream_header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, list_intervals_stream_header::magic_value(), sizeof(header.magic));
+		header.version = list_intervals_stream_header::current_version;
+		header.endian = list_intervals_file_header::endian_value;
+		header.base_width = sizeof(base_type);
+		if (!os.write((const char*) &header, sizeof(header))) {
+			throw file_exception();
+		}
+	}
+
+	static void dump_stream_chunk(std::ostream& os, interval_type const* ints, size_t n)
+	{
+		while (n > 0) {
+			const uint32_t frame_size = std::min(n, (size_t) stream_frame_size);
+			os.write((const char*) &frame_size, sizeof(uint32_t));
+			os.write((const char*) ints, frame_size*sizeof(interval_type));
+			if (!os) {
+				throw file_exception();
+			}
+			ints += frame_size;
+			n -= frame_size;
+		}
 	}
 
-	void dump_stream(std::ostream& os)
+	static void dump_stream_end(std::ostream& os)
 	{
-		uint32_t nintervals = strict_integer_cast<uint32_t>(intervals().size());
-		os << nintervals;
-		os.write((const char*) &intervals()[0], intervals().size()*sizeof(interval_type));
+		const uint32_t end = 0;
+		if (!os.write((const char*) &end, sizeof(uint32_t))) {
+			throw file_exception();
+		}
 	}
 
 	void dump_to_fd(int fd)
@@ -586,6 +1010,7 @@ public:
 				throw file_format_exception("invalid interval");
 			}
 		}
+		compute_stats();
 	}
 
 	void dump_to_file(const char* file)
@@ -612,6 +1037,305 @@ public:
 		close(fd);
 	}
 
+	// Write the list in the versioned container format described in
+	// list_intervals_format.h, with the index cache if it has been created.
+	// The cache of a list that isn't aggregated is out of date, and isn't
+	// written.
+	void dump_container_to_fd(int fd) const
+	{
+		if (fd == -1) {
+			throw file_exception();
+		}
+
+		list_intervals_file_header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, list_intervals_file_header::magic_value(), sizeof(header.magic));
+		header.version = list_intervals_file_header::current_version;
+		header.endian = list_intervals_file_header::endian_value;
+		header.base_width = sizeof(base_type);
+		header.size_width = sizeof(size_type);
+		header.flags = is_aggregated() ? list_intervals_file_header::flag_aggregated : 0;
+		header.intervals_count = intervals().size();
+		header.size = size();
+		header.intervals_offset = list_intervals_file_header::align_offset(sizeof(header));
+		const size_t intervals_size = intervals().size()*sizeof(interval_type);
+		if (is_aggregated() && (_cache_entry_size > 0) && !_index_cache.empty()) {
+			header.cache_entry_size = _cache_entry_size;
+			header.cache_count = _index_cache.size();
+			header.cache_offset = list_intervals_file_header::align_offset(header.intervals_offset + intervals_size);
+		}
+		const size_t cache_size = header.cache_count*sizeof(size_type);
+		uint64_t checksum = __impl::checksum_update(__impl::checksum_init, intervals().data(), intervals_size);
+		header.checksum = __impl::checksum_update(checksum, _index_cache.data(), cache_size);
+
+		static const char zeros[list_intervals_file_header::align] = {0};
+		if (!__impl::write_all(fd, &header, sizeof(header)) ||
+		    !__impl::write_all(fd, zeros, header.intervals_offset - sizeof(header)) ||
+		    !__impl::write_all(fd, intervals().data(), intervals_size)) {
+			throw file_exception();
+		}
+		if (cache_size > 0) {
+			if (!__impl::write_all(fd, zeros, header.cache_offset - header.intervals_offset - intervals_size) ||
+			    !__impl::write_all(fd, _index_cache.data(), cache_size)) {
+				throw file_exception();
+			}
+		}
+	}
+
+	void read_container_from_fd(int fd, bool const verify_checksum = true)
+	{
+		list_intervals_file_header header;
+		if (!__impl::read_all(fd, &header, sizeof(header))) {
+			throw_read_error();
+		}
+		// The sections must end before the end of the file, counted from the
+		// start of the header
+		struct stat st;
+		const off_t pos = lseek(fd, 0, SEEK_CUR);
+		if ((pos == -1) || (fstat(fd, &st) != 0)) {
+			throw file_exception();
+		}
+		const uint64_t file_size = (st.st_size > pos) ? (uint64_t) (st.st_size - pos) + sizeof(header) : sizeof(header);
+		const char* err = header.check(sizeof(base_type), sizeof(size_type), sizeof(interval_type), file_size);
+		if (err != nullptr) {
+			throw file_format_exception(err);
+		}
+
+		clear();
+		const size_t intervals_size = header.intervals_count*sizeof(interval_type);
+		intervals().resize(header.intervals_count);
+		if ((lseek(fd, header.intervals_offset - sizeof(header), SEEK_CUR) == -1) ||
+		    !__impl::read_all(fd, intervals().data(), intervals_size)) {
+			clear();
+			throw_read_error();
+		}
+		std::vector<size_type> cache;
+		if (header.cache_entry_size != 0) {
+			cache.resize(header.cache_count);
+			if ((lseek(fd, header.cache_offset - header.intervals_offset - intervals_size, SEEK_CUR) == -1) ||
+			    !__impl::read_all(fd, cache.data(), cache.size()*sizeof(size_type))) {
+				clear();
+				throw_read_error();
+			}
+		}
+
+		if (verify_checksum) {
+			const uint64_t checksum = __impl::checksum_update(__impl::checksum_init, intervals().data(), intervals_size);
+			if (__impl::checksum_update(checksum, cache.data(), cache.size()*sizeof(size_type)) != header.checksum) {
+				clear();
+				throw file_format_exception("invalid checksum");
+			}
+		}
+
+		// The checksum doesn't tell whether the content is valid, and can be
+		// skipped: check the intervals, their order if the list is said to be
+		// aggregated, and the prefix sums of the index cache.
+		const bool aggregated = (header.flags & list_intervals_file_header::flag_aggregated) != 0;
+		container_type const& ints = intervals();
+		size_type cur_size(0);
+		for (size_t i = 0; i < ints.size(); i++) {
+			if ((ints[i].lower() >= ints[i].upper()) ||
+			    (aggregated && (i > 0) && (ints[i].lower() < ints[i-1].upper()))) {
+				clear();
+				throw file_format_exception("invalid interval");
+			}
+			cur_size += ints[i].width();
+			if ((header.cache_entry_size != 0) &&
+			    (((i+1) % header.cache_entry_size == 0) || (i+1 == ints.size())) &&
+			    (cache[i/header.cache_entry_size] != cur_size)) {
+				clear();
+				throw file_format_exception("invalid index cache");
+			}
+		}
+
+		compute_stats();
+		if (aggregated) {
+			_aggregated_count = intervals().size();
+		}
+		_index_cache = std::move(cache);
+		_cache_entry_size = header.cache_entry_size;
+	}
+
+	void dump_container_to_file(const char* file) const
+	{
+		int fd = open(file, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+		if (fd == -1) {
+			throw file_exception();
+		}
+
+		try {
+			dump_container_to_fd(fd);
+		}
+		catch (...) {
+			close(fd);
+			throw;
+		}
+
+		close(fd);
+	}
+
+	void read_container_from_file(const char* file, bool const verify_checksum = true)
+	{
+		int fd = open(file, O_RDONLY);
+		if (fd == -1) {
+			throw file_exception();
+		}
+
+		try {
+			read_container_from_fd(fd, verify_checksum);
+		}
+		catch (...) {
+			close(fd);
+			throw;
+		}
+
+		close(fd);
+	}
+
+	// Write the list in the compressed format described in
+	// list_intervals_format.h. It is meant for aggregated lists, whose gaps
+	// and widths are small, but any list can be written.
+	void dump_compressed_stream(std::ostream& os) const
+	{
+		list_intervals_compressed_header header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, list_intervals_compressed_header::magic_value(), sizeof(header.magic));
+		header.version = list_intervals_compressed_header::current_version;
+		header.endian = list_intervals_file_header::endian_value;
+		header.base_width = sizeof(base_type);
+		header.flags = is_aggregated() ? list_intervals_file_header::flag_aggregated : 0;
+		header.intervals_count = intervals().size();
+		os.write((const char*) &header, sizeof(header));
+
+		static constexpr size_t B = __impl::bit_packing_block_size;
+		static constexpr size_t nstreams = 2*compressed_halves;
+		uint32_t vals[nstreams][B];
+		uint32_t packed[B];
+		// Blocks are gathered in this buffer before being written
+		std::vector<char> buf;
+		buf.reserve(compressed_write_buffer_size + nstreams*(1+sizeof(packed)));
+
+		interval_type const* ints = intervals().data();
+		const size_t n = intervals().size();
+		base_type prev_upper(0);
+		for (size_t block = 0; block < n; block += B) {
+			const size_t count = std::min(B, n-block);
+			for (size_t i = 0; i < count; i++) {
+				interval_type const& it = ints[block+i];
+				const uint64_t gap = (base_type) (it.lower() - prev_upper);
+				const uint64_t width = (base_type) (it.width() - 1);
+				for (size_t h = 0; h < compressed_halves; h++) {
+					vals[h][i] = (uint32_t) (gap >> (32*h));
+					vals[compressed_halves+h][i] = (uint32_t) (width >> (32*h));
+				}
+				prev_upper = it.upper();
+			}
+			for (size_t s = 0; s < nstreams; s++) {
+				std::fill(&vals[s][count], &vals[s][B], 0);
+			}
+
+			unsigned char widths[nstreams];
+			for (size_t s = 0; s < nstreams; s++) {
+				widths[s] = __impl::bit_packing_width(vals[s]);
+			}
+			buf.insert(buf.end(), (char const*) widths, (char const*) widths + nstreams);
+			for (size_t s = 0; s < nstreams; s++) {
+				__impl::bit_pack128(vals[s], packed, widths[s]);
+				buf.insert(buf.end(), (char const*) packed, (char const*) packed + __impl::bit_packing_bytes(widths[s]));
+			}
+			if (buf.size() >= compressed_write_buffer_size) {
+				os.write(buf.data(), buf.size());
+				buf.clear();
+			}
+		}
+		os.write(buf.data(), buf.size());
+		if (!os) {
+			throw file_exception();
+		}
+	}
+
+	// Read a list written by dump_compressed_stream. The blocks are decoded
+	// one by one while they are read.
+	void read_compressed_stream(std::istream& is)
+	{
+		list_intervals_compressed_header header;
+		if (!is.read((char*) &header, sizeof(header))) {
+			throw file_format_exception("truncated file");
+		}
+		const char* err = header.check(sizeof(base_type));
+		if (err != nullptr) {
+			throw file_format_exception(err);
+		}
+
+		static constexpr size_t B = __impl::bit_packing_block_size;
+		static constexpr size_t nstreams = 2*compressed_halves;
+		uint32_t vals[nstreams][B];
+		uint32_t packed[nstreams*B];
+
+		// Gaps wrap around when the list isn't sorted, which can't happen
+		// in an aggregated list
+		const bool aggregated = (header.flags & list_intervals_file_header::flag_aggregated) != 0;
+		const base_type max = std::numeric_limits<base_type>::max();
+
+		// The count of the header can't be trusted, so the intervals are
+		// allocated as their blocks are read
+		clear();
+		const uint64_t n = header.intervals_count;
+		base_type prev_upper(0);
+		for (uint64_t block = 0; block < n; block += B) {
+			unsigned char widths[nstreams];
+			if (!is.read((char*) widths, nstreams)) {
+				clear();
+				throw file_format_exception("truncated file");
+			}
+			size_t packed_size = 0;
+			for (size_t s = 0; s < nstreams; s++) {
+				if (widths[s] > 32) {
+					clear();
+					throw file_format_exception("invalid bit width");
+				}
+				packed_size += __impl::bit_packing_bytes(widths[s]);
+			}
+			if (!is.read((char*) packed, packed_size)) {
+				clear();
+				throw file_format_exception("truncated file");
+			}
+			uint32_t const* cur_packed = packed;
+			for (size_t s = 0; s < nstreams; s++) {
+				__impl::bit_unpack128(cur_packed, vals[s], widths[s]);
+				cur_packed += __impl::bit_packing_bytes(widths[s])/sizeof(uint32_t);
+			}
+
+			const size_t count = std::min((uint64_t) B, n-block);
+			intervals().resize(block+count);
+			interval_type* ints = intervals().data();
+			for (size_t i = 0; i < count; i++) {
+				uint64_t gap = 0;
+				uint64_t width = 0;
+				for (size_t h = 0; h < compressed_halves; h++) {
+					gap |= ((uint64_t) vals[h][i]) << (32*h);
+					width |= ((uint64_t) vals[compressed_halves+h][i]) << (32*h);
+				}
+				if ((gap > max) || (aggregated && (gap > (uint64_t) (max - prev_upper)))) {
+					clear();
+					throw file_format_exception("invalid interval");
+				}
+				const base_type lower = prev_upper + (base_type) gap;
+				if (width >= (uint64_t) (max - lower)) {
+					clear();
+					throw file_format_exception("invalid interval");
+				}
+				prev_upper = lower + (base_type) width + 1;
+				ints[block+i] = interval_type(lower, prev_upper);
+			}
+		}
+
+		compute_stats();
+		if (aggregated) {
+			_aggregated_count = intervals().size();
+		}
+	}
+
 #ifdef LEELOO_BOOST_SERIALIZE
 	template<class Archive>
 	void save(Archive& ar, unsigned int const /*version*/) const
@@ -624,6 +1348,7 @@ public:
 	{
 		clear();
 		ar & boost::serialization::make_nvp("intervals", intervals());
+		compute_stats();
 	}
 
 	BOOST_SERIALIZATION_SPLIT_MEMBER()
@@ -656,41 +1381,176 @@ private:
 			}
 		}
 
+		_aggregated_count = 0;
 		aggregate();
 	}
 
-	static void aggregate_container(container_type& ints)
+	void aggregate_intervals()
 	{
-		if (ints.size() <= 1) {
-			return;
+		container_type& ints = intervals();
+		const size_t nclean = _aggregated_count;
+		const size_t ndelta = ints.size()-nclean;
+		if ((nclean == 0) || (ndelta > nclean)) {
+			// Not worth it, do it from scratch
+			aggregate_container(ints);
 		}
-		
+		else
+		if (ndelta > 0) {
+			typename container_type::iterator it_delta = ints.begin()+nclean;
+			tbb::parallel_sort(it_delta, ints.end(), cmp_f());
+			ints.erase(it_delta+merge_sorted(&(*it_delta), ndelta), ints.end());
+
+			merge_delta(ints, nclean);
+			ints.erase(ints.begin()+merge_sorted_parallel(&ints[0], ints.size()), ints.end());
+		}
+		_aggregated_count = ints.size();
+	}
+
+	// Merge the sorted intervals of ints[0,nclean[ and ints[nclean,end[ in
+	// place, without the temporary buffer of std::inplace_merge. The second
+	// run is moved at the end of a buffer grown by its size, so that the
+	// merge can be done from the end without the write cursor reaching an
+	// interval that hasn't been read yet.
+	static void merge_delta(container_type& ints, size_t const nclean)
+	{
+		const size_t ndelta = ints.size()-nclean;
+		ints.resize(nclean+2*ndelta);
+		std::copy(ints.begin()+nclean, ints.begin()+nclean+ndelta, ints.begin()+nclean+ndelta);
+
+		interval_type const* const delta = &ints[nclean+ndelta];
+		size_t i = nclean;
+		size_t j = ndelta;
+		size_t w = nclean+ndelta;
+		// Once the second run is merged, the remaining intervals of the first
+		// one are already in place
+		while (j > 0) {
+			if ((i > 0) && cmp_f()(delta[j-1], ints[i-1])) {
+				ints[--w] = ints[--i];
+			}
+			else {
+				ints[--w] = delta[--j];
+			}
+		}
+		ints.resize(nclean+ndelta);
+	}
+
+	static void aggregate_container(container_type& ints)
+	{
+		if (ints.size() <= 1) {
+			return;
+		}
+		
 		tbb::parallel_sort(ints.begin(), ints.end(), cmp_f());
 
-		container_type ret;
-		interval_type cur_merge = ints.front();
+		const size_t new_size = merge_sorted_parallel(&ints[0], ints.size());
+		ints.erase(ints.begin()+new_size, ints.end());
+	}
 
-		typename container_type::const_iterator it = ints.begin()+1;
+	// Merge the sorted intervals of [ints,ints+n[ in place. Returns the number
+	// of intervals that remain at the beginning of the buffer.
+	static size_t merge_sorted(interval_type* ints, size_t const n)
+	{
+		if (n == 0) {
+			return 0;
+		}
 
-		// TODO: there is plenty of room for memory optimisations,
-		// vectorisation and //isation ;)
-		for (; it != ints.end(); it++) {
-			interval_type const& cur_int = *it;
-			if (utility::overlap(cur_merge, cur_int)) {
-				cur_merge = utility::hull(cur_merge, cur_int);
+		size_t w = 0;
+		for (size_t i = 1; i < n; i++) {
+			interval_type const& cur_int = ints[i];
+			if (utility::overlap(ints[w], cur_int)) {
+				ints[w] = utility::hull(ints[w], cur_int);
 			}
 			else {
-				ret.push_back(cur_merge);
-				cur_merge = cur_int;
+				w++;
+				ints[w] = cur_int;
+			}
+		}
+		return w+1;
+	}
+
+	// Same as merge_sorted, but each chunk of merge_chunk_size intervals is
+	// merged in parallel. The chunks boundaries are then fixed up and the
+	// results compacted at the beginning of the buffer.
+	static size_t merge_sorted_parallel(interval_type* ints, size_t const n)
+	{
+		if (n < 2*merge_chunk_size) {
+			return merge_sorted(ints, n);
+		}
+
+		const size_t nchunks = (n+merge_chunk_size-1)/merge_chunk_size;
+		std::vector<size_t> chunks_size(nchunks);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, nchunks, 1),
+			[ints,n,&chunks_size](tbb::blocked_range<size_t> const& r)
+			{
+				for (size_t c = r.begin(); c != r.end(); c++) {
+					const size_t start = c*merge_chunk_size;
+					chunks_size[c] = merge_sorted(&ints[start], std::min(merge_chunk_size, n-start));
+				}
+			});
+
+		size_t w = chunks_size[0];
+		for (size_t c = 1; c < nchunks; c++) {
+			interval_type const* const chunk = &ints[c*merge_chunk_size];
+			const size_t chunk_size = chunks_size[c];
+
+			// The last merged interval can overlap the first intervals of
+			// this chunk
+			size_t i = 0;
+			interval_type& last = ints[w-1];
+			while ((i < chunk_size) && utility::overlap(last, chunk[i])) {
+				last = utility::hull(last, chunk[i]);
+				i++;
+			}
+
+			// Destination is always before the source, so a forward copy is
+			// safe.
+			std::copy(&chunk[i], &chunk[chunk_size], &ints[w]);
+			w += chunk_size-i;
+		}
+
+		return w;
+	}
+
+	// Both intervals() and removed_intervals() must be aggregated. The results
+	// are written back into intervals() with a write cursor. As a removed
+	// interval can split an interval in two, the write cursor can get ahead
+	// of the read one: a first pass computes by how much, and the buffer is
+	// only grown (and its content shifted) by that amount.
+	void subtract_removed_intervals()
+	{
+		container_type& ints = intervals();
+		const size_t n = ints.size();
+
+		size_t nout = 0;
+		size_t lead = 0;
+		typename container_type::const_iterator it_removed = removed_intervals().begin();
+		for (size_t i = 0; i < n; i++) {
+			split_merged_interval_removed(ints[i], it_removed,
+				[&nout](interval_type const&) { nout++; });
+			if (nout > i+1) {
+				lead = std::max(lead, nout-(i+1));
 			}
 		}
 
-		ret.push_back(cur_merge);
+		if (lead > 0) {
+			ints.resize(n+lead);
+			std::copy_backward(ints.begin(), ints.begin()+n, ints.end());
+		}
+
+		size_t w = 0;
+		it_removed = removed_intervals().begin();
+		for (size_t i = lead; i < n+lead; i++) {
+			const interval_type cur_merge = ints[i];
+			split_merged_interval_removed(cur_merge, it_removed,
+				[&ints,&w](interval_type const& it) { ints[w++] = it; });
+		}
+		assert(w == nout);
 
-		ints = std::move(ret);
+		ints.erase(ints.begin()+w, ints.end());
 	}
 
-	void split_merged_interval_removed(interval_type const& cur_merge_, container_type& ret, typename container_type::const_iterator& it_removed)
+	template <class F>
+	void split_merged_interval_removed(interval_type const& cur_merge_, typename container_type::const_iterator& it_removed, F const& f) const
 	{
 		bool notend;
 		while (((notend = it_removed != removed_intervals().end())) &&
@@ -723,7 +1583,7 @@ private:
 				else
 				if ((cur_merge.lower() <= rem_lower) &&
 					(cur_merge.upper() >= rem_upper)) {
-					ret.emplace_back(cur_merge.lower(), rem_lower);
+					f(interval_type(cur_merge.lower(), rem_lower));
 					cur_merge.set_lower(rem_upper);
 				}
 
@@ -733,8 +1593,369 @@ private:
 		}
 
 		if (cur_merge.width() > 0) {
-			ret.push_back(cur_merge);
+			f(cur_merge);
+		}
+	}
+
+	// Sweep over the bounds of the sorted intervals of a and b, clipped to
+	// [lo,hi[ (or [lo,+inf[ if clip_hi is false), and call f with each
+	// interval of the result of Op.
+	template <class Op, class F>
+	static void set_operation_sweep(interval_type const* a, size_t const na, interval_type const* b, size_t const nb, base_type const lo, base_type const hi, bool const clip_hi, F const& f)
+	{
+		size_t i = 0;
+		size_t j = 0;
+		bool in_a = false;
+		bool in_b = false;
+		bool in_ret = false;
+		base_type start_ret = 0;
+		while ((i < na) || (j < nb)) {
+			const bool has_a = i < na;
+			const bool has_b = j < nb;
+			const base_type xa = has_a ? (in_a ? clip_upper(a[i], hi, clip_hi) : std::max(a[i].lower(), lo)) : 0;
+			const base_type xb = has_b ? (in_b ? clip_upper(b[j], hi, clip_hi) : std::max(b[j].lower(), lo)) : 0;
+			const base_type x = (has_a && (!has_b || (xa <= xb))) ? xa : xb;
+			if (has_a && (xa == x)) {
+				i += in_a;
+				in_a = !in_a;
+			}
+			if (has_b && (xb == x)) {
+				j += in_b;
+				in_b = !in_b;
+			}
+			const bool now_in_ret = Op::in(in_a, in_b);
+			if (now_in_ret != in_ret) {
+				if (now_in_ret) {
+					start_ret = x;
+				}
+				else
+				if (x > start_ret) {
+					f(interval_type(start_ret, x));
+				}
+				in_ret = now_in_ret;
+			}
+		}
+	}
+
+	static inline base_type clip_upper(interval_type const& it, base_type const hi, bool const clip_hi)
+	{
+		return clip_hi ? std::min(it.upper(), hi) : it.upper();
+	}
+
+	static inline void append_merge(container_type& ints, interval_type const& it)
+	{
+		if ((ints.size() > 0) && (ints.back().upper() == it.lower())) {
+			ints.back().set_upper(it.upper());
+		}
+		else {
+			ints.push_back(it);
+		}
+	}
+
+	// Call f(i, in) with whether values[i] is in the (aggregated) list
+	template <class F>
+	void contains_batch_impl(base_type const* values, size_t const n, F const& f) const
+	{
+		if (n == 0) {
+			return;
+		}
+		if (std::is_sorted(values, values+n)) {
+			contains_batch_sorted(values, n, f);
+			return;
+		}
+
+		static constexpr size_t G = contains_batch_group;
+		const size_t ngroups = n/G;
+		if (has_search_index()) {
+			size_t pos[G];
+			for (size_t g = 0; g < ngroups; g++) {
+				base_type const* v = &values[g*G];
+				_search_index.template predecessors<G>(v, pos);
+				for (size_t l = 0; l < G; l++) {
+					f(g*G+l, (pos[l] != 0) && (v[l] < _search_index.value_at(pos[l])));
+				}
+			}
+		}
+		else
+		if (intervals().size() > 0) {
+			// Branchless binary searches of the first interval whose upper
+			// bound is above each value
+			interval_type const* ints = &intervals()[0];
+			const size_t nints = intervals().size();
+			size_t base[G];
+			for (size_t g = 0; g < ngroups; g++) {
+				base_type const* v = &values[g*G];
+				for (size_t l = 0; l < G; l++) {
+					base[l] = 0;
+				}
+				size_t len = nints;
+				while (len > 1) {
+					const size_t half = len/2;
+					for (size_t l = 0; l < G; l++) {
+						base[l] = (ints[base[l]+half-1].upper() <= v[l]) ? base[l]+half : base[l];
+						__builtin_prefetch(&ints[base[l]+(len-half)/2]);
+					}
+					len -= half;
+				}
+				for (size_t l = 0; l < G; l++) {
+					f(g*G+l, ints[base[l]].contains(v[l]));
+				}
+			}
+		}
+		else {
+			for (size_t i = 0; i < ngroups*G; i++) {
+				f(i, false);
+			}
+		}
+
+		for (size_t i = ngroups*G; i < n; i++) {
+			f(i, contains(values[i]));
+		}
+	}
+
+	template <class F>
+	void contains_batch_sorted(base_type const* values, size_t const n, F const& f) const
+	{
+		container_type const& ints = intervals();
+		const size_t nints = ints.size();
+		size_t cur = 0;
+		for (size_t i = 0; i < n; i++) {
+			const base_type v = values[i];
+			if ((cur < nints) && (ints[cur].upper() <= v)) {
+				// Gallop to the first interval whose upper bound is above v
+				size_t step = 1;
+				while ((cur+step < nints) && (ints[cur+step].upper() <= v)) {
+					step *= 2;
+				}
+				cur = std::partition_point(ints.begin()+cur+step/2+1, ints.begin()+std::min(cur+step, nints),
+					[v](interval_type const& it) { return it.upper() <= v; }) - ints.begin();
+			}
+			f(i, (cur < nints) && ints[cur].contains(v));
+		}
+	}
+
+	// Index of the first interval of (aggregated) ints whose upper bound is
+	// strictly above x
+	static size_t first_upper_above(container_type const& ints, base_type const x)
+	{
+		return std::upper_bound(ints.begin(), ints.end(), x,
+			[](base_type const x_, interval_type const& it) { return x_ < it.upper(); }) - ints.begin();
+	}
+
+	// Index of the first interval of (aggregated) ints whose lower bound is
+	// above or equal to x
+	static size_t first_lower_above(container_type const& ints, base_type const x)
+	{
+		return std::lower_bound(ints.begin(), ints.end(), x,
+			[](interval_type const& it, base_type const x_) { return it.lower() < x_; }) - ints.begin();
+	}
+
+	static void concat_lists(container_type& dst, std::vector<list_intervals const*> const& lists)
+	{
+		std::vector<size_t> offsets;
+		offsets.reserve(lists.size());
+		size_t total = dst.size();
+		for (list_intervals const* o: lists) {
+			offsets.push_back(total);
+			total += o->intervals_count();
+		}
+		dst.resize(total);
+		tbb::parallel_for(size_t(0), lists.size(),
+			[&](size_t const i)
+			{
+				container_type const& src = lists[i]->intervals();
+				std::copy(src.begin(), src.end(), dst.begin() + offsets[i]);
+			});
+	}
+
+	static void read_stream_header(std::istream& is)
+	{
+		list_intervals_stream_header header;
+		if (!is.read((char*) &header, sizeof(header))) {
+			throw file_format_exception("truncated file");
+		}
+		const char* err = header.check(sizeof(base_type));
+		if (err != nullptr) {
+			throw file_format_exception(err);
+		}
+	}
+
+	static size_t read_stream_frame_size(std::istream& is)
+	{
+		uint32_t n;
+		if (!is.read((char*) &n, sizeof(uint32_t))) {
+			throw file_format_exception("truncated file");
+		}
+		if (n > stream_frame_size) {
+			throw file_format_exception("invalid frame size");
+		}
+		return n;
+	}
+
+	static void read_stream_frame(std::istream& is, interval_type* ints, size_t const n)
+	{
+		if (!is.read((char*) ints, n*sizeof(interval_type))) {
+			throw file_format_exception("truncated file");
+		}
+		for (size_t i = 0; i < n; i++) {
+			if (ints[i].lower() >= ints[i].upper()) {
+				throw file_format_exception("invalid interval");
+			}
+		}
+	}
+
+	// read_all() sets errno to 0 on a premature end of file
+	static void throw_read_error()
+	{
+		if (errno == 0) {
+			throw file_format_exception("truncated file");
+		}
+		throw file_exception();
+	}
+
+	inline void clear_index_cache()
+	{
+		_index_cache.clear();
+		_cache_entry_size = 0;
+	}
+
+	inline void reset_stats()
+	{
+		_size = 0;
+		_min_width = std::numeric_limits<base_type>::max();
+		_max_width = 0;
+	}
+
+	inline void update_stats(base_type const width)
+	{
+		_size += width;
+		_min_width = std::min(_min_width, width);
+		_max_width = std::max(_max_width, width);
+	}
+
+	void compute_stats()
+	{
+		reset_stats();
+		for (interval_type const& i: intervals()) {
+			update_stats(i.width());
+		}
+	}
+
+	inline base_type at_rank_index(base_type const r) const
+	{
+		// Intervals with a null width share the rank of the next one, and
+		// the predecessor is the last of them.
+		const size_t pos = _rank_index.predecessor(r);
+		return intervals()[_rank_index.value_at(pos)].lower() + (r - _rank_index.key_at(pos));
+	}
+
+	// Index of the interval that contains the value of rank r, and the rank
+	// of the first value of this interval
+	inline size_t locate_rank(base_type const r, base_type& start) const
+	{
+		if (has_rank_index()) {
+			const size_t pos = _rank_index.predecessor(r);
+			start = _rank_index.key_at(pos);
+			return _rank_index.value_at(pos);
+		}
+		const size_t a = std::upper_bound(_index_cache.begin(), _index_cache.end(), r) - _index_cache.begin();
+		start = (a > 0) ? _index_cache[a-1] : 0;
+		return a*_cache_entry_size;
+	}
+
+	void at_cached_batch_forward(base_type const* ranks, base_type* out, size_t const n) const
+	{
+		interval_type const* ints = intervals().data();
+		base_type start;
+		size_t idx = locate_rank(ranks[0], start);
+		for (size_t i = 0; i < n; i++) {
+			const base_type r = ranks[i];
+			size_t steps = 0;
+			if (r >= start) {
+				while ((steps < at_batch_max_walk) && ((r - start) >= ints[idx].width())) {
+					start += ints[idx].width();
+					idx++;
+					steps++;
+				}
+			}
+			if ((r < start) || (steps == at_batch_max_walk)) {
+				idx = locate_rank(r, start);
+				while ((r - start) >= ints[idx].width()) {
+					start += ints[idx].width();
+					idx++;
+				}
+			}
+			out[i] = ints[idx].lower() + (r - start);
+		}
+	}
+
+	void at_cached_batch_interleaved(base_type const* ranks, base_type* out, size_t const n) const
+	{
+		static constexpr size_t G = at_batch_group;
+		const size_t ngroups = n/G;
+		interval_type const* ints = intervals().data();
+		base_type r[G];
+		if (has_rank_index()) {
+			size_t pos[G];
+			for (size_t g = 0; g < ngroups; g++) {
+				std::copy(&ranks[g*G], &ranks[(g+1)*G], r);
+				_rank_index.template predecessors<G>(r, pos);
+				for (size_t l = 0; l < G; l++) {
+					__builtin_prefetch(&ints[_rank_index.value_at(pos[l])]);
+				}
+				for (size_t l = 0; l < G; l++) {
+					out[g*G+l] = ints[_rank_index.value_at(pos[l])].lower() + (r[l] - _rank_index.key_at(pos[l]));
+				}
+			}
+		}
+		else {
+			// Branchless binary searches of the first cache entry that ends
+			// after each rank
+			size_type const* cache = _index_cache.data();
+			const size_t ncache = _index_cache.size();
+			size_t base[G];
+			for (size_t g = 0; g < ngroups; g++) {
+				std::copy(&ranks[g*G], &ranks[(g+1)*G], r);
+				for (size_t l = 0; l < G; l++) {
+					base[l] = 0;
+				}
+				size_t len = ncache;
+				while (len > 1) {
+					const size_t half = len/2;
+					for (size_t l = 0; l < G; l++) {
+						base[l] = (cache[base[l]+half-1] <= r[l]) ? base[l]+half : base[l];
+						__builtin_prefetch(&cache[base[l]+(len-half)/2]);
+					}
+					len -= half;
+				}
+				for (size_t l = 0; l < G; l++) {
+					__builtin_prefetch(&ints[base[l]*_cache_entry_size]);
+				}
+				for (size_t l = 0; l < G; l++) {
+					base_type start = (base[l] > 0) ? cache[base[l]-1] : 0;
+					size_t idx = base[l]*_cache_entry_size;
+					while ((r[l] - start) >= ints[idx].width()) {
+						start += ints[idx].width();
+						idx++;
+					}
+					out[g*G+l] = ints[idx].lower() + (r[l] - start);
+				}
+			}
+		}
+
+		for (size_t i = ngroups*G; i < n; i++) {
+			out[i] = at_cached(ranks[i]);
+		}
+	}
+
+	inline base_type at_index_cache(base_type const r) const
+	{
+		ssize_t cur;
+		const size_t interval_idx = get_cached_interval_idx(r, cur);
+		if (cur == 0) {
+			return intervals()[interval_idx].lower();
 		}
+		return get_rth_value(cur, interval_idx, intervals().size());
 	}
 
 	size_type get_rth_value(base_type const r, size_t const interval_start, size_t const interval_end) const
@@ -757,33 +1978,8 @@ private:
 
 	size_t get_cached_interval_idx(size_type const r, ssize_t& rem) const
 	{
-		// Dichotomy!
-		size_t a = 0;
-		size_t b = _index_cache.size();
-
-		// Tradeoff
-		while ((b-a) > 4) {
-			const size_t mid = (b+a)/2;
-			const size_type vmid = _index_cache[mid];
-			if (vmid == r) {
-				// You get lucky
-				rem = 0;
-				return (mid+1)*_cache_entry_size;
-			}
-			if (vmid < r) {
-				a = mid;
-			}
-			else {
-				b = mid;
-			}
-		}
-
-		// Finish this!
-		size_type v;
-		while ((v = _index_cache[a]) < r) {
-			a++;
-		}
-
+		// First cache entry that ends after r
+		const size_t a = std::upper_bound(_index_cache.begin(), _index_cache.end(), r) - _index_cache.begin();
 		if (a > 0) {
 			rem = (ssize_t)r-(ssize_t)_index_cache[a-1];
 		}
@@ -811,8 +2007,212 @@ private:
 	container_type _excluded_intervals;
 	std::vector<size_type> _index_cache;
 	size_t _cache_entry_size;
+	// Number of intervals at the beginning of intervals() that are aggregated
+	size_t _aggregated_count;
+	// Lower bounds => upper bounds
+	eytzinger_index<base_type, base_type> _search_index;
+	// Number of values before an interval => index of this interval
+	eytzinger_index<base_type, size_type> _rank_index;
+	// Statistics about intervals(), updated by add() and computed again by
+	// aggregate() and the loading functions
+	base_type _size;
+	base_type _min_width;
+	base_type _max_width;
 };
 
+// Read-only slice of an aggregated list, that doesn't copy its intervals.
+// The first and last intervals of the slice can be clipped.
+template <class ListIntervals>
+class list_intervals_view
+{
+public:
+	typedef ListIntervals list_type;
+	typedef typename list_type::interval_type interval_type;
+	typedef typename list_type::base_type base_type;
+	typedef typename list_type::size_type size_type;
+
+	// Number of intervals per entry of the prefix sums used by at(), so that
+	// the scan after the binary search reads about one cache line
+	static constexpr size_t prefix_entry_size = (sizeof(interval_type) < 64) ? 64/sizeof(interval_type) : 1;
+
+public:
+	// Const iterator over the (clipped) intervals of the view
+	class iterator: std::iterator<std::forward_iterator_tag, interval_type>
+	{
+	public:
+		iterator():
+			_view(nullptr),
+			_idx(0)
+		{ }
+
+		iterator(list_intervals_view const& view, size_t const idx):
+			_view(&view),
+			_idx(idx)
+		{ }
+
+	public:
+		iterator& operator++()
+		{
+			++_idx;
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+
+		interval_type operator*() const
+		{
+			return _view->interval_at(_idx);
+		}
+
+		bool operator!=(iterator const& other) const
+		{
+			return _idx != other._idx;
+		}
+
+		bool operator==(iterator const& other) const
+		{
+			return _idx == other._idx;
+		}
+
+	private:
+		list_intervals_view const* _view;
+		size_t _idx;
+	};
+
+public:
+	list_intervals_view():
+		_ints(nullptr),
+		_count(0),
+		_lower_first(0),
+		_upper_last(0),
+		_size(0)
+	{ }
+
+	// Intervals [first,last[ of list, with the lower bound of the first one
+	// and the upper bound of the last one replaced by the given values.
+	list_intervals_view(list_type const& list, size_t const first, size_t const last, base_type const lower_first, base_type const upper_last):
+		_ints(list.intervals().data() + first),
+		_count(last-first),
+		_lower_first(lower_first),
+		_upper_last(upper_last),
+		_size(0)
+	{
+		_size = build_prefix();
+	}
+
+	// Same, when the number of values of the view is already known
+	list_intervals_view(list_type const& list, size_t const first, size_t const last, base_type const lower_first, base_type const upper_last, base_type const size):
+		_ints(list.intervals().data() + first),
+		_count(last-first),
+		_lower_first(lower_first),
+		_upper_last(upper_last),
+		_size(size)
+	{
+		build_prefix();
+		assert(_prefix.empty() || (_prefix.back() == size));
+	}
+
+public:
+	inline base_type size() const { return _size; }
+	inline size_t intervals_count() const { return _count; }
+
+	inline interval_type interval_at(size_t const idx) const
+	{
+		interval_type ret = _ints[idx];
+		if (idx == 0) {
+			ret.set_lower(_lower_first);
+		}
+		if (idx == _count-1) {
+			ret.set_upper(_upper_last);
+		}
+		return ret;
+	}
+
+	bool contains(base_type const v) const
+	{
+		// Last interval whose lower bound is lower or equal to v
+		const size_t idx = std::upper_bound(_ints, _ints+_count, v,
+			[](base_type const v_, interval_type const& it) { return v_ < it.lower(); }) - _ints;
+		return (idx > 0) && interval_at(idx-1).contains(v);
+	}
+
+	base_type at(base_type const r) const
+	{
+		assert(r < size());
+		// First prefix entry that ends after r
+		const size_t a = std::upper_bound(_prefix.begin(), _prefix.end(), r) - _prefix.begin();
+		base_type start = (a > 0) ? _prefix[a-1] : 0;
+		for (size_t i = a*prefix_entry_size; i < _count; i++) {
+			const interval_type it = interval_at(i);
+			if ((r - start) < it.width()) {
+				return it.lower() + (r - start);
+			}
+			start += it.width();
+		}
+		return -1;
+	}
+
+	iterator begin() const { return iterator(*this, 0); }
+	iterator end() const { return iterator(*this, _count); }
+
+private:
+	// Fill _prefix with the number of values up to the end of each group of
+	// prefix_entry_size intervals, and return the size of the view
+	size_type build_prefix()
+	{
+		_prefix.reserve((_count+prefix_entry_size-1)/prefix_entry_size);
+		size_type cur_size(0);
+		for (size_t i = 0; i < _count; i += prefix_entry_size) {
+			const size_t j_end = std::min(_count, i+prefix_entry_size);
+			for (size_t j = i; j < j_end; j++) {
+				cur_size += interval_at(j).width();
+			}
+			_prefix.push_back(cur_size);
+		}
+		return cur_size;
+	}
+
+private:
+	interval_type const* _ints;
+	size_t _count;
+	base_type _lower_first;
+	base_type _upper_last;
+	base_type _size;
+	std::vector<size_type> _prefix;
+};
+
+// Set operations between two aggregated lists. Use the parallel template
+// argument to process big lists with several tasks.
+
+template <bool parallel = false, class Interval, class SizeType>
+inline list_intervals<Interval, SizeType> set_union(list_intervals<Interval, SizeType> const& a, list_intervals<Interval, SizeType> const& b)
+{
+	return list_intervals<Interval, SizeType>::template set_operation<__impl::set_union_op, parallel>(a, b);
+}
+
+template <bool parallel = false, class Interval, class SizeType>
+inline list_intervals<Interval, SizeType> set_intersection(list_intervals<Interval, SizeType> const& a, list_intervals<Interval, SizeType> const& b)
+{
+	return list_intervals<Interval, SizeType>::template set_operation<__impl::set_intersection_op, parallel>(a, b);
+}
+
+template <bool parallel = false, class Interval, class SizeType>
+inline list_intervals<Interval, SizeType> set_difference(list_intervals<Interval, SizeType> const& a, list_intervals<Interval, SizeType> const& b)
+{
+	return list_intervals<Interval, SizeType>::template set_operation<__impl::set_difference_op, parallel>(a, b);
+}
+
+template <bool parallel = false, class Interval, class SizeType>
+inline list_intervals<Interval, SizeType> set_symmetric_difference(list_intervals<Interval, SizeType> const& a, list_intervals<Interval, SizeType> const& b)
+{
+	return list_intervals<Interval, SizeType>::template set_operation<__impl::set_symmetric_difference_op, parallel>(a, b);
+}
+
 }
 
 // Common exported instanciations (outside of any namespace)
@@ -832,6 +2232,10 @@ extern template class LEELOO_API leeloo::list_intervals<leeloo::interval<uint16_
 extern template class LEELOO_API leeloo::list_intervals<leeloo::interval<uint32_t>>;
 #endif
 
+#ifdef LEELOO_INCLUDE_U64
+extern template class LEELOO_API leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t>;
+#endif
+
 #endif
 
 #endif
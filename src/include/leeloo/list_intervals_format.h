@@ -0,0 +1,272 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LEELOO_LIST_INTERVALS_FORMAT_H
+#define LEELOO_LIST_INTERVALS_FORMAT_H
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace leeloo {
+
+// On-disk container format of list_intervals. The file starts with this
+// header, followed by the intervals and by the optional index cache, each
+// section starting at an offset aligned on list_intervals_file_header::align
+// so that a mapping of the file can be used in place. Everything is written
+// in the native byte order, which is checked thanks to the endian field.
+//
+// The index cache holds the number of values of the list up to the end of
+// each group of cache_entry_size intervals. With cache_entry_size == 1, this
+// is the full prefix sum of the interval widths.
+struct list_intervals_file_header
+{
+	static constexpr uint32_t current_version = 1;
+	static constexpr uint32_t endian_value = 0x01020304;
+	static constexpr uint64_t align = 64;
+
+	static constexpr uint8_t flag_aggregated = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t endian;
+	// sizeof(base_type) and sizeof(size_type)
+	uint8_t base_width;
+	uint8_t size_width;
+	uint8_t flags;
+	uint8_t reserved[5];
+	uint64_t intervals_count;
+	// Total number of values
+	uint64_t size;
+	uint64_t intervals_offset;
+	// Index cache, if cache_entry_size is not 0
+	uint64_t cache_entry_size;
+	uint64_t cache_count;
+	uint64_t cache_offset;
+	// Checksum of the intervals and of the index cache
+	uint64_t checksum;
+
+	// 8 bytes, without the final NUL
+	static inline const char* magic_value() { return "LEELOOIL"; }
+
+	static inline uint64_t align_offset(uint64_t const off)
+	{
+		return (off + align - 1) & ~(align - 1);
+	}
+
+	inline bool has_magic() const
+	{
+		return memcmp(magic, magic_value(), sizeof(magic)) == 0;
+	}
+
+	// Returns an error message if the header can't be used with these types,
+	// or nullptr. The sections must end before file_size.
+	const char* check(size_t const base_width_, size_t const size_width_, size_t const interval_width, uint64_t const file_size) const
+	{
+		if (!has_magic()) {
+			return "invalid magic";
+		}
+		if (version != current_version) {
+			return "unsupported version";
+		}
+		if (endian != endian_value) {
+			return "invalid byte order";
+		}
+		if ((base_width != base_width_) || (size_width != size_width_)) {
+			return "invalid type width";
+		}
+		if ((intervals_offset % align != 0) ||
+		    (intervals_offset < sizeof(list_intervals_file_header)) ||
+		    (intervals_offset > file_size) ||
+		    (intervals_count > file_size/interval_width) ||
+		    (intervals_offset + intervals_count*interval_width > file_size)) {
+			return "invalid intervals section";
+		}
+		if ((cache_entry_size != 0) &&
+		    ((cache_offset % align != 0) ||
+		     (cache_offset > file_size) ||
+		     (cache_count > file_size/size_width) ||
+		     (cache_offset < intervals_offset + intervals_count*interval_width) ||
+		     (cache_offset + cache_count*size_width > file_size) ||
+		     (cache_count != (intervals_count + cache_entry_size - 1)/cache_entry_size))) {
+			return "invalid index cache section";
+		}
+		return nullptr;
+	}
+};
+
+// Header of the compressed stream format of list_intervals. It is followed
+// by blocks of bit_packing_block_size intervals (the last one can be
+// partial). For each interval, the block holds the gap between its lower
+// bound and the upper bound of the previous interval, and its width minus
+// one, both modulo 2^(8*base_width). Each of these two streams is cut into
+// 32-bit halves, and a block starts with the bit width of each
+// (stream, half), followed by the corresponding bit-packed data (see
+// bit_packing.h).
+struct list_intervals_compressed_header
+{
+	static inline const char* magic_value() { return "LEELOOIZ"; }
+	static constexpr uint32_t current_version = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t endian;
+	uint8_t base_width;
+	uint8_t flags;
+	uint8_t reserved[6];
+	uint64_t intervals_count;
+
+	inline bool has_magic() const
+	{
+		return memcmp(magic, magic_value(), sizeof(magic)) == 0;
+	}
+
+	const char* check(size_t const base_width_) const
+	{
+		if (!has_magic()) {
+			return "invalid magic";
+		}
+		if (version != current_version) {
+			return "unsupported version";
+		}
+		if (endian != list_intervals_file_header::endian_value) {
+			return "invalid byte order";
+		}
+		if (base_width != base_width_) {
+			return "invalid type width";
+		}
+		return nullptr;
+	}
+};
+
+// Header of the framed stream format of list_intervals. It is followed by
+// frames made of a 32-bit number of intervals and of the raw intervals, and
+// a frame with no intervals ends the stream. The total number of intervals
+// doesn't need to be known when writing starts, and a frame can be processed
+// as soon as it has been read.
+struct list_intervals_stream_header
+{
+	static inline const char* magic_value() { return "LEELOOIS"; }
+	static constexpr uint32_t current_version = 1;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t endian;
+	uint8_t base_width;
+	uint8_t reserved[7];
+
+	const char* check(size_t const base_width_) const
+	{
+		if (memcmp(magic, magic_value(), sizeof(magic)) != 0) {
+			return "invalid magic";
+		}
+		if (version != current_version) {
+			return "unsupported version";
+		}
+		if (endian != list_intervals_file_header::endian_value) {
+			return "invalid byte order";
+		}
+		if (base_width != base_width_) {
+			return "invalid type width";
+		}
+		return nullptr;
+	}
+};
+
+namespace __impl {
+
+// 64-bit multiplicative hash, fed with successive buffers
+inline uint64_t checksum_update(uint64_t h, void const* buf, size_t const size)
+{
+	static constexpr uint64_t prime = 0x100000001b3ULL;
+	unsigned char const* p = (unsigned char const*) buf;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t w;
+		memcpy(&w, &p[i], sizeof(uint64_t));
+		h = (h ^ w) * prime;
+		h ^= h >> 29;
+	}
+	if (i < size) {
+		uint64_t w = 0;
+		memcpy(&w, &p[i], size - i);
+		h = (h ^ w) * prime;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+static constexpr uint64_t checksum_init = 0xcbf29ce484222325ULL;
+
+// Return false on error, with errno set. A premature end of file sets errno
+// to 0.
+inline bool write_all(int fd, void const* buf, size_t size)
+{
+	char const* p = (char const*) buf;
+	while (size > 0) {
+		const ssize_t w = write(fd, p, size);
+		if (w < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		p += w;
+		size -= w;
+	}
+	return true;
+}
+
+inline bool read_all(int fd, void* buf, size_t size)
+{
+	char* p = (char*) buf;
+	while (size > 0) {
+		const ssize_t r = read(fd, p, size);
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		if (r == 0) {
+			errno = 0;
+			return false;
+		}
+		p += r;
+		size -= r;
+	}
+	return true;
+}
+
+} // __impl
+
+}
+
+#endif
@@ -0,0 +1,492 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LEELOO_LIST_INTERVALS_MMAP_H
+#define LEELOO_LIST_INTERVALS_MMAP_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <leeloo/list_intervals.h>
+#include <leeloo/uni.h>
+
+namespace leeloo {
+
+// Read-only list of intervals backed by a memory mapping of a file written by
+// list_intervals::dump_container_to_fd() or list_intervals::dump_to_fd(). The
+// intervals aren't copied and processes that map the same file share the page
+// cache. The file must contain aggregated intervals. Only the container format
+// maps in O(1): the size and the index cache are read from the file and used
+// in place. Raw intervals have no header, so mapping them reads every interval
+// to compute their size, and they have no index cache until
+// create_index_cache() is called.
+template <class ListIntervals>
+class list_intervals_mmap
+{
+public:
+	typedef ListIntervals list_type;
+	typedef typename list_type::interval_type interval_type;
+	typedef typename list_type::base_type base_type;
+	typedef typename list_type::size_type size_type;
+	typedef interval_type const* iterator;
+
+public:
+	list_intervals_mmap():
+		_map(nullptr),
+		_map_size(0),
+		_ints(nullptr),
+		_count(0),
+		_size(0),
+		_cache(nullptr),
+		_cache_count(0),
+		_cache_entry_size(0)
+	{ }
+
+	list_intervals_mmap(list_intervals_mmap const&) = delete;
+
+	list_intervals_mmap(list_intervals_mmap&& o):
+		list_intervals_mmap()
+	{
+		swap(o);
+	}
+
+	~list_intervals_mmap()
+	{
+		unmap();
+	}
+
+public:
+	list_intervals_mmap& operator=(list_intervals_mmap const&) = delete;
+
+	list_intervals_mmap& operator=(list_intervals_mmap&& o)
+	{
+		if (&o != this) {
+			unmap();
+			swap(o);
+		}
+		return *this;
+	}
+
+public:
+	void map_file(const char* file, bool const verify_checksum = false)
+	{
+		int fd = open(file, O_RDONLY);
+		if (fd == -1) {
+			throw file_exception();
+		}
+
+		try {
+			map_fd(fd, verify_checksum);
+		}
+		catch (...) {
+			close(fd);
+			throw;
+		}
+
+		close(fd);
+	}
+
+	// The file descriptor can be closed once mapped. The checksum of the
+	// container format is only verified on request, as this reads the whole
+	// file.
+	void map_fd(int fd, bool const verify_checksum = false)
+	{
+		unmap();
+
+		struct stat st;
+		if (fstat(fd, &st) == -1) {
+			throw file_exception();
+		}
+		const size_t size = st.st_size;
+		if (size == 0) {
+			return;
+		}
+
+		void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			throw file_exception();
+		}
+		_map = map;
+		_map_size = size;
+
+		list_intervals_file_header const* header = (list_intervals_file_header const*) map;
+		if ((size >= sizeof(list_intervals_file_header)) && header->has_magic()) {
+			const char* err = header->check(sizeof(base_type), sizeof(size_type), sizeof(interval_type), size);
+			if ((err == nullptr) && ((header->flags & list_intervals_file_header::flag_aggregated) == 0)) {
+				err = "intervals aren't aggregated";
+			}
+			if ((err == nullptr) && verify_checksum) {
+				const uint64_t checksum = __impl::checksum_update(__impl::checksum_init, (char const*) map + header->intervals_offset, header->intervals_count*sizeof(interval_type));
+				if (__impl::checksum_update(checksum, (char const*) map + header->cache_offset, header->cache_count*sizeof(size_type)) != header->checksum) {
+					err = "invalid checksum";
+				}
+			}
+			if (err != nullptr) {
+				unmap();
+				throw file_format_exception(err);
+			}
+			_ints = (interval_type const*) ((char const*) map + header->intervals_offset);
+			_count = header->intervals_count;
+			_size = header->size;
+			if (header->cache_entry_size != 0) {
+				_cache = (size_type const*) ((char const*) map + header->cache_offset);
+				_cache_count = header->cache_count;
+				_cache_entry_size = header->cache_entry_size;
+			}
+			return;
+		}
+
+		// Raw intervals, as written by list_intervals::dump_to_fd()
+		if (size % sizeof(interval_type) != 0) {
+			unmap();
+			throw file_format_exception("invalid size");
+		}
+		_ints = (interval_type const*) map;
+		_count = size/sizeof(interval_type);
+		for (size_t i = 0; i < _count; i++) {
+			_size += _ints[i].width();
+		}
+	}
+
+	void unmap()
+	{
+		if (_map != nullptr) {
+			munmap(_map, _map_size);
+		}
+		_map = nullptr;
+		_map_size = 0;
+		_ints = nullptr;
+		_count = 0;
+		_size = 0;
+		_own_cache.clear();
+		_cache = nullptr;
+		_cache_count = 0;
+		_cache_entry_size = 0;
+	}
+
+	// Check that the intervals are valid and sorted. This reads the whole
+	// file.
+	bool validate() const
+	{
+		for (size_t i = 0; i < _count; i++) {
+			if (_ints[i].lower() >= _ints[i].upper()) {
+				return false;
+			}
+			if ((i > 0) && (_ints[i].lower() <= _ints[i-1].upper())) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+public:
+	inline base_type size() const { return _size; }
+
+	inline size_t intervals_count() const { return _count; }
+	inline interval_type const& interval_at(size_t const idx) const { return _ints[idx]; }
+
+	iterator begin() const { return _ints; }
+	iterator end() const { return _ints+_count; }
+
+	bool contains(base_type const v) const
+	{
+		// Last interval whose lower bound is lower or equal to v
+		const size_t idx = std::upper_bound(_ints, _ints+_count, v,
+			[](base_type const v_, interval_type const& it) { return v_ < it.lower(); }) - _ints;
+		return (idx > 0) && _ints[idx-1].contains(v);
+	}
+
+	base_type at(base_type const r) const
+	{
+		assert(r < size());
+		return get_rth_value(r, 0);
+	}
+
+	base_type at_cached(base_type const r) const
+	{
+		assert(r < size() && _cache_entry_size > 0);
+		base_type start;
+		const size_t idx = locate_rank(_cache, _cache_count, _cache_entry_size, r, start);
+		return get_rth_value(r - start, idx);
+	}
+
+	// out[i] = at_cached(ranks[i]), for i in [0,n[. out can be ranks. See
+	// list_intervals::at_cached_batch.
+	void at_cached_batch(base_type const* ranks, base_type* out, size_t const n) const
+	{
+		assert(_cache_entry_size > 0);
+		at_batch(_cache, _cache_count, _cache_entry_size, ranks, out, n);
+	}
+
+	// cache_entry_size defines the number of intervals that represent a cache
+	// entry. The cache is private to this object, and replaces the one of the
+	// file if any.
+	void create_index_cache(size_t const cache_entry_size)
+	{
+		assert(cache_entry_size > 0);
+		_cache_entry_size = cache_entry_size;
+		_size = build_index_cache(cache_entry_size, _own_cache);
+		_cache = _own_cache.data();
+		_cache_count = _own_cache.size();
+	}
+
+	size_t create_index_cache()
+	{
+		const size_t entry_size = list_type::default_index_cache_entry_size(_count);
+		create_index_cache(entry_size);
+		return entry_size;
+	}
+
+	inline size_t index_cache_entry_size() const { return _cache_entry_size; }
+	inline bool has_index_cache() const { return _cache_entry_size > 0; }
+
+	template <template <class T_, bool atomic_> class UPRNG, class Fset, class RandEngine>
+	void random_sets(size_type size_div, Fset const& fset, RandEngine const& rand_eng) const
+	{
+		if (size_div <= 0) {
+			size_div = 1;
+		}
+		random_sets<UPRNG>([size_div](size_t) { return size_div; }, size_div, fset, rand_eng);
+	}
+
+	template <template <class T_, bool atomic_> class UPRNG, class Fset, class Fsize_div, class RandEngine>
+	void random_sets(Fsize_div const& fsize_div, const size_t size_max, Fset const& fset, RandEngine const& rand_eng) const
+	{
+		if (size_max == 0) {
+			return;
+		}
+
+		base_type size_rem = size();
+		UPRNG<base_type, false> uprng;
+		uprng.init(size_rem, rand_eng);
+
+		// Without an index cache, each lookup would read all the intervals
+		// before the drawn rank. Build a private one for this call.
+		std::vector<size_type> tmp_cache;
+		size_type const* cache = _cache;
+		size_t cache_count = _cache_count;
+		size_t cache_entry_size = _cache_entry_size;
+		if (!has_index_cache()) {
+			cache_entry_size = list_type::default_index_cache_entry_size(_count);
+			build_index_cache(cache_entry_size, tmp_cache);
+			cache = tmp_cache.data();
+			cache_count = tmp_cache.size();
+		}
+
+		std::vector<base_type> buf;
+		buf.resize(size_max);
+
+		size_t i = 0;
+		while (size_rem > 0) {
+			const size_t size = std::min(integer_cast<size_t>(fsize_div(i)), integer_cast<size_t>(size_rem));
+			if ((size > size_max) || (size == 0)) {
+				break;
+			}
+			for (size_t j = 0; j < size; j++) {
+				buf[j] = uprng();
+			}
+			at_batch(cache, cache_count, cache_entry_size, buf.data(), buf.data(), size);
+			fset(buf.data(), size);
+
+			i++;
+			size_rem -= size;
+		}
+	}
+
+	template <class Fset, class RandEngine>
+	inline void random_sets(size_type size_div, Fset const& fset, RandEngine const& rand_eng) const
+	{
+		random_sets<uni>(size_div, fset, rand_eng);
+	}
+
+	template <class Fset, class Fsize_div, class RandEngine>
+	inline void random_sets(Fsize_div const& fsize_div, const size_t size_max, Fset const& fset, RandEngine const& rand_eng) const
+	{
+		random_sets<uni>(fsize_div, size_max, fset, rand_eng);
+	}
+
+private:
+	// Fill cache with the total width of the intervals up to the end of
+	// each cache entry, and return the size of the list
+	size_type build_index_cache(size_t const cache_entry_size, std::vector<size_type>& cache) const
+	{
+		cache.clear();
+		cache.reserve((_count+cache_entry_size-1)/cache_entry_size);
+		size_type cur_size(0);
+		for (size_t i = 0; i < _count; i += cache_entry_size) {
+			const size_t j_end = std::min(_count, i+cache_entry_size);
+			for (size_t j = i; j < j_end; j++) {
+				cur_size += _ints[j].width();
+			}
+			cache.push_back(cur_size);
+		}
+		return cur_size;
+	}
+
+	// Index of the first interval of the cache entry that contains the value
+	// of rank r, and the rank of the first value of this interval
+	static inline size_t locate_rank(size_type const* cache, size_t const cache_count, size_t const cache_entry_size, base_type const r, base_type& start)
+	{
+		const size_t a = std::upper_bound(cache, cache+cache_count, r) - cache;
+		start = (a > 0) ? cache[a-1] : 0;
+		return a*cache_entry_size;
+	}
+
+	// Same algorithms as list_intervals::at_cached_batch_forward and
+	// list_intervals::at_cached_batch_interleaved, with the given index cache
+	void at_batch(size_type const* cache, size_t const cache_count, size_t const cache_entry_size, base_type const* ranks, base_type* out, size_t const n) const
+	{
+		if (n == 0) {
+			return;
+		}
+
+		size_t ndesc = 0;
+		for (size_t i = 1; i < n; i++) {
+			ndesc += (ranks[i] < ranks[i-1]);
+		}
+		if (ndesc*list_type::at_batch_sorted_ratio <= n) {
+			at_batch_forward(cache, cache_count, cache_entry_size, ranks, out, n);
+		}
+		else {
+			at_batch_interleaved(cache, cache_count, cache_entry_size, ranks, out, n);
+		}
+	}
+
+	void at_batch_forward(size_type const* cache, size_t const cache_count, size_t const cache_entry_size, base_type const* ranks, base_type* out, size_t const n) const
+	{
+		static constexpr size_t max_walk = list_type::at_batch_max_walk;
+		base_type start;
+		size_t idx = locate_rank(cache, cache_count, cache_entry_size, ranks[0], start);
+		for (size_t i = 0; i < n; i++) {
+			const base_type r = ranks[i];
+			size_t steps = 0;
+			if (r >= start) {
+				while ((steps < max_walk) && ((r - start) >= _ints[idx].width())) {
+					start += _ints[idx].width();
+					idx++;
+					steps++;
+				}
+			}
+			if ((r < start) || (steps == max_walk)) {
+				idx = locate_rank(cache, cache_count, cache_entry_size, r, start);
+				while ((r - start) >= _ints[idx].width()) {
+					start += _ints[idx].width();
+					idx++;
+				}
+			}
+			out[i] = _ints[idx].lower() + (r - start);
+		}
+	}
+
+	void at_batch_interleaved(size_type const* cache, size_t const cache_count, size_t const cache_entry_size, base_type const* ranks, base_type* out, size_t const n) const
+	{
+		static constexpr size_t G = list_type::at_batch_group;
+		const size_t ngroups = n/G;
+		base_type r[G];
+		size_t base[G];
+		for (size_t g = 0; g < ngroups; g++) {
+			std::copy(&ranks[g*G], &ranks[(g+1)*G], r);
+			for (size_t l = 0; l < G; l++) {
+				base[l] = 0;
+			}
+			size_t len = cache_count;
+			while (len > 1) {
+				const size_t half = len/2;
+				for (size_t l = 0; l < G; l++) {
+					base[l] = (cache[base[l]+half-1] <= r[l]) ? base[l]+half : base[l];
+					__builtin_prefetch(&cache[base[l]+(len-half)/2]);
+				}
+				len -= half;
+			}
+			for (size_t l = 0; l < G; l++) {
+				__builtin_prefetch(&_ints[base[l]*cache_entry_size]);
+			}
+			for (size_t l = 0; l < G; l++) {
+				base_type start = (base[l] > 0) ? cache[base[l]-1] : 0;
+				size_t idx = base[l]*cache_entry_size;
+				while ((r[l] - start) >= _ints[idx].width()) {
+					start += _ints[idx].width();
+					idx++;
+				}
+				out[g*G+l] = _ints[idx].lower() + (r[l] - start);
+			}
+		}
+
+		for (size_t i = ngroups*G; i < n; i++) {
+			base_type start;
+			const size_t idx = locate_rank(cache, cache_count, cache_entry_size, ranks[i], start);
+			out[i] = get_rth_value(ranks[i] - start, idx);
+		}
+	}
+
+	base_type get_rth_value(base_type r, size_t const interval_start) const
+	{
+		for (size_t i = interval_start; i < _count; i++) {
+			const base_type width = _ints[i].width();
+			if (r < width) {
+				return _ints[i].lower() + r;
+			}
+			r -= width;
+		}
+		return -1;
+	}
+
+	void swap(list_intervals_mmap& o)
+	{
+		std::swap(_map, o._map);
+		std::swap(_map_size, o._map_size);
+		std::swap(_ints, o._ints);
+		std::swap(_count, o._count);
+		std::swap(_size, o._size);
+		std::swap(_own_cache, o._own_cache);
+		std::swap(_cache, o._cache);
+		std::swap(_cache_count, o._cache_count);
+		std::swap(_cache_entry_size, o._cache_entry_size);
+	}
+
+private:
+	void* _map;
+	size_t _map_size;
+	interval_type const* _ints;
+	size_t _count;
+	base_type _size;
+	// Index cache, either in the mapping or in _own_cache
+	std::vector<size_type> _own_cache;
+	size_type const* _cache;
+	size_t _cache_count;
+	size_t _cache_entry_size;
+};
+
+}
+
+#endif
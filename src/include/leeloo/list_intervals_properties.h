@@ -31,6 +31,7 @@
 
 #include <leeloo/list_intervals.h>
 #include <leeloo/bit_field.h>
+#include <leeloo/eytzinger_index.h>
 #include <leeloo/sort_permute.h>
 
 #include <list>
@@ -287,6 +288,8 @@ public:
 	template <class FAdd, class FRemove, class FDuplicate>
 	void aggregate_properties(FAdd const& fadd, FRemove const& fremove, FDuplicate const& fdup)
 	{
+		_search_index.clear();
+
 		if (ir().size_elts() == 0) {
 			properties().clear_storage();
 			return;
@@ -330,6 +333,8 @@ public:
 	template <class FAdd, class FDuplicate>
 	void aggregate_properties_no_rem(FAdd const& fadd, FDuplicate const& fdup)
 	{
+		_search_index.clear();
+
 		if (ir().size_elts() == 0) {
 			properties().clear_storage();
 			return;
@@ -376,8 +381,32 @@ public:
 		ir().clear_storage();
 	}
 
+	// Build a frozen search index used by property_of(), with the lower
+	// bounds of the intervals in Eytzinger order. It is dropped by the next
+	// aggregation.
+	void create_search_index()
+	{
+		_search_index.build(properties().size(),
+			[this](size_t const i) { return properties().interval_at(i).lower(); },
+			[](size_t const i) { return size_type(i); });
+	}
+
+	inline bool has_search_index() const { return !_search_index.empty(); }
+
 	property_type const* property_of(base_type const& v) const
 	{
+		if (has_search_index()) {
+			const size_t pos = _search_index.predecessor(v);
+			if (pos == 0) {
+				return nullptr;
+			}
+			const size_type idx = _search_index.value_at(pos);
+			if (properties().interval_at(idx).contains(v)) {
+				return &properties().property_at(idx);
+			}
+			return nullptr;
+		}
+
 		// TODO: somehow factorize this code with list_intervals::contains
 		size_type a(0);
 		size_type b = properties().size(); 
@@ -432,6 +461,8 @@ private:
 private:
 	properties_storage_type _properties;
 	properties_ir _properties_ir;
+	// Lower bounds => index in _properties
+	eytzinger_index<base_type, size_type> _search_index;
 };
 
 }
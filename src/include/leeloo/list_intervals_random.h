@@ -225,6 +225,10 @@ private:
 extern template class LEELOO_API leeloo::list_intervals_random<leeloo::list_intervals<leeloo::interval<uint32_t>>, leeloo::uni, false>;
 #endif
 
+#ifdef LEELOO_INCLUDE_U64
+extern template class LEELOO_API leeloo::list_intervals_random<leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t>, leeloo::uni, false>;
+#endif
+
 #endif
 
 #endif
@@ -29,8 +29,23 @@
 #ifndef LEELOO_MATH_HELPERS_H
 #define LEELOO_MATH_HELPERS_H
 
+#include <cstdint>
+#include <type_traits>
+
 namespace leeloo {
 
+namespace __impl {
+
+// Integer type able to hold the product of two Integer values
+template <class Integer>
+struct wide_integer
+{
+	static_assert(sizeof(Integer) <= 8, "Integers wider than 64-bit integers aren't supported.");
+	typedef typename std::conditional<(sizeof(Integer) <= 4), uint64_t, unsigned __int128>::type type;
+};
+
+} // __impl
+
 template <class Integer>
 inline Integer log2i(Integer const v)
 {
@@ -49,16 +64,118 @@ inline Integer is_pow2(Integer const v)
 	return (((Integer)1)<<log2i(v)) == v;
 }
 
+// (a*b)%m, without overflowing
+template <class Integer>
+inline Integer mul_mod(Integer const a, Integer const b, Integer const m)
+{
+	typedef typename __impl::wide_integer<Integer>::type wide_type;
+	return ((wide_type)a*(wide_type)b) % m;
+}
+
+// (a+b)%m, without overflowing. a and b must be lower than m.
+template <class Integer>
+inline Integer add_mod(Integer const a, Integer const b, Integer const m)
+{
+	return (a >= m-b) ? a-(m-b) : a+b;
+}
+
+namespace __impl {
+
+// Computes (a*b)%m for a modulus m known in advance, with multiplications
+// and shifts only. Barrett reduction is used up to 32 bits.
+template <class Integer, bool wide = (sizeof(Integer) > 4)>
+class mod_reducer
+{
+public:
+	void init(Integer const m)
+	{
+		_m = m;
+		// floor((2^64-1)/m) underestimates the quotients by at most one
+		_inv = (m == 0) ? 0 : (~((uint64_t)0))/m;
+	}
+
+	inline Integer reduce(uint64_t const x) const
+	{
+		const uint64_t q = ((unsigned __int128)x*_inv) >> 64;
+		const uint64_t r = x - q*_m;
+		return (r >= _m) ? r-_m : r;
+	}
+
+	inline Integer mul(Integer const a, Integer const b) const
+	{
+		return reduce((uint64_t)a*(uint64_t)b);
+	}
+
+	// Constant used by the vectorised versions of reduce()
+	inline uint64_t inv() const { return _inv; }
+
+private:
+	uint64_t _inv;
+	uint64_t _m;
+};
+
+// Montgomery multiplication for 64-bit integers. m must be odd, and a and b
+// lower than m.
+template <class Integer>
+class mod_reducer<Integer, true>
+{
+public:
+	void init(Integer const m)
+	{
+		_m = m;
+		if ((m & 1) == 0) {
+			_inv = _r2 = 0;
+			return;
+		}
+		// m^-1 mod 2^64 with Newton's method. m is its own inverse modulo 8,
+		// and each iteration doubles the number of valid bits.
+		uint64_t inv = m;
+		for (int i = 0; i < 5; i++) {
+			inv *= 2 - m*inv;
+		}
+		_inv = inv;
+		// 2^128 mod m
+		const uint64_t r = ((uint64_t)(-m)) % m;
+		_r2 = mul_mod<uint64_t>(r, r, m);
+	}
+
+	inline Integer mul(Integer const a, Integer const b) const
+	{
+		// redc(a*b) = a*b*2^-64, and a second multiplication by 2^128 gets
+		// back to a*b
+		return redc((unsigned __int128)redc((unsigned __int128)a*b)*_r2);
+	}
+
+private:
+	// x*2^-64 mod m, for x < m*2^64
+	inline uint64_t redc(unsigned __int128 const x) const
+	{
+		// The low halves of x and t*m are equal, so that x-t*m is divisible
+		// by 2^64
+		const uint64_t t = (uint64_t)x*_inv;
+		const uint64_t u = ((unsigned __int128)t*_m) >> 64;
+		const uint64_t hi = x >> 64;
+		return (hi >= u) ? hi-u : hi-u+_m;
+	}
+
+private:
+	uint64_t _inv;
+	uint64_t _r2;
+	uint64_t _m;
+};
+
+} // __impl
+
 template <class Integer>
 Integer exp_mod(Integer v, Integer e, Integer const m)
 {
 	Integer r = 1;
 	while (e > 0) {
 		if ((e & 1) == 1) {
-			r = ((uint64_t)r*(uint64_t)v) % m;
+			r = mul_mod(r, v, m);
 		}
 		e >>= 1;
-		v = ((uint64_t)v*(uint64_t)v) % m;
+		v = mul_mod(v, v, m);
 	}
 	return r;
 }
@@ -29,43 +29,118 @@
 #ifndef LEELOO_PRIME_HELPERS_H
 #define LEELOO_PRIME_HELPERS_H
 
+#include <cstdint>
+#include <initializer_list>
+
 #include <x86intrin.h>
 #include <leeloo/math_helpers.h>
 
 namespace leeloo {
 
+namespace __impl {
+
+// Odd primes used to discard most of the composites before running
+// Miller-Rabin.
+static constexpr uint8_t small_odd_primes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97};
+static constexpr uint64_t small_odd_primes_bound = 101*101;
+
+// Strong probable prime test of the odd integer n to base a
 template <class Integer>
-bool is_prime(Integer const v)
+bool is_strong_probable_prime(Integer const n, Integer a)
+{
+	a %= n;
+	if (a == 0) {
+		return true;
+	}
+	Integer d = n-1;
+	unsigned int s = 0;
+	while ((d & 1) == 0) {
+		d >>= 1;
+		s++;
+	}
+	Integer x = exp_mod(a, d, n);
+	if ((x == 1) || (x == n-1)) {
+		return true;
+	}
+	for (unsigned int r = 1; r < s; r++) {
+		x = mul_mod(x, x, n);
+		if (x == n-1) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Deterministic Miller-Rabin test for odd 32-bit integers. There is no strong
+// pseudoprime to bases 2, 7 and 61 below 4759123141 (Jaeschke).
+inline bool is_prime_miller_rabin32(uint32_t const v)
+{
+	for (uint32_t const a: {2U, 7U, 61U}) {
+		if (!is_strong_probable_prime(v, a)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Deterministic Miller-Rabin test for odd 64-bit integers. This set of bases
+// is known to have no strong pseudoprime below 2^64 (Jim Sinclair).
+inline bool is_prime_miller_rabin64(uint64_t const v)
 {
-	// Don't check with two because we only check odd numbers
-	Integer const v_sqrt = sqrt(v);
-	for (Integer d = 3; d <= v_sqrt; d++) {
-		// TODO: does gcc vectorize this ?
-		if ((v % d) == 0) {
+	for (uint64_t const a: {2ULL, 325ULL, 9375ULL, 28178ULL, 450775ULL, 9780504ULL, 1795265022ULL}) {
+		if (!is_strong_probable_prime(v, a)) {
 			return false;
 		}
 	}
 	return true;
 }
 
+} // __impl
+
 template <class Integer>
-Integer find_previous_matching_prime(Integer const v)
+bool is_prime(Integer const v)
 {
-	Integer p;
 	if ((v & 1) == 0) {
-		p = v - 1;
+		return v == 2;
 	}
-	else {
-		p = v;
+	if (v < 3) {
+		return false;
 	}
 
-	for (; p >= 3; p -= 2) {
-		if (is_prime(p) && ((p&3) == 3)) {
-			return p;
+	for (uint8_t const p: __impl::small_odd_primes) {
+		if (v == p) {
+			return true;
+		}
+		if ((v % p) == 0) {
+			return false;
 		}
 	}
+	// No prime factor lower than 101
+	if ((uint64_t) v < __impl::small_odd_primes_bound) {
+		return true;
+	}
 
-	return 0;
+	if (((uint64_t) v >> 32) == 0) {
+		return __impl::is_prime_miller_rabin32(v);
+	}
+	return __impl::is_prime_miller_rabin64(v);
+}
+
+// Greatest prime lower or equal to v that is congruent to 3 modulo 4, or 0 if
+// there is none.
+template <class Integer>
+Integer find_previous_matching_prime(Integer const v)
+{
+	if (v < 3) {
+		return 0;
+	}
+
+	// 3 is prime, so that this always ends
+	Integer p = v - ((v - 3) & 3);
+	while (!is_prime(p)) {
+		p -= 4;
+	}
+	return p;
 }
 
 template <class Integer>
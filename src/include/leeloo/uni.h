@@ -35,6 +35,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <limits>
 #include <type_traits>
 
@@ -43,6 +44,7 @@
 #include <tbb/atomic.h>
 
 #include <leeloo/atomic_helpers.h>
+#include <leeloo/cpu_features.h>
 #include <leeloo/intrinsics.h>
 #include <leeloo/prime_helpers.h>
 
@@ -52,7 +54,7 @@ template <class Integer, bool atomic = false>
 class uni
 {
 	static_assert(std::is_signed<Integer>::value == false, "Integer must be an unsigned integer type.");
-	static_assert(sizeof(Integer) <= 4, "Integers wider than 32-bit integers aren't supported.");
+	static_assert(sizeof(Integer) <= 8, "Integers wider than 64-bit integers aren't supported.");
 
 public:
 	typedef Integer integer_type;
@@ -65,7 +67,8 @@ public:
 	}
 
 	template <class Engine>
-	uni(integer_type const max, Engine const& rand_eng)
+	uni(integer_type const max, Engine const& rand_eng):
+		_rem_perm(nullptr)
 	{
 		init(max, rand_eng);
 	}
@@ -83,8 +86,10 @@ public:
 	 * \param max defines the interval of the generated integers. max isn't included (between [0,max[).
 	 */
 	template <class Engine>
-	void init(integer_type const max, Engine const& rand_eng)
+	void init(integer_type const max, Engine const& rand_eng_)
 	{
+		// The engine may have been created for a narrower type
+		typename Engine::template rebond<integer_type>::result rand_eng(rand_eng_);
 		_intermediate_off = rand_eng(0, max-1);
 		_cur_pos = rand_eng(0, max-1);
 
@@ -98,14 +103,22 @@ public:
 	integer_type operator()()
 	{
 		const integer_type pos = __impl::pos_increment(_cur_pos, _max);
-		const integer_type res = residue((residue(pos) + _intermediate_off) % _max);
+		const integer_type res = residue(add_mod(residue(pos), _intermediate_off, _max));
 		return res;
 	}
 
+	// Write the next n integers to out
+	void fill(integer_type* out, size_t const n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			out[i] = (*this)();
+		}
+	}
+
 	inline integer_type get_step(integer_type const step) const
 	{
-		const integer_type real_step = (_cur_pos + step) % _max;
-		return residue((residue(real_step) + _intermediate_off) % _max);
+		const integer_type real_step = add_mod((integer_type) _cur_pos, (step < _max) ? step : (integer_type) (step % _max), _max);
+		return residue(add_mod(residue(real_step), _intermediate_off, _max));
 	}
 
 private:
@@ -117,7 +130,7 @@ private:
 			// Use the final permutation
 			return _rem_perm[v-prime];
 		}
-		const integer_type residue = ((uint64_t) v * (uint64_t) v) % prime;
+		const integer_type residue = _prime_reducer.mul(v, v);
 		return (v <= (prime / 2)) ? residue : prime - residue;
 	}
 
@@ -125,6 +138,7 @@ private:
 	void init_prime(integer_type const max)
 	{
 		_prime = find_previous_matching_prime(max);
+		_prime_reducer.init(_prime);
 		_max = max;
 	}
 
@@ -150,15 +164,31 @@ private:
 
 private:
 	integer_type _prime;
+	__impl::mod_reducer<integer_type> _prime_reducer;
 	integer_type _max;
 	integer_type _intermediate_off;
 	integer_type* _rem_perm;
 	pos_integer_type _cur_pos;
 };
 
-#ifdef __SSE4_2__
+// Tags of the vector versions of uni<uint32_t>, which generate 4 (SSE4.2), 8
+// (AVX2) or 16 (AVX-512) integers at once. The vector types themselves aren't
+// used as template arguments, as their alignment attributes would be ignored.
+struct sse42_lanes { };
+struct avx2_lanes { };
+struct avx512_lanes { };
+
+// Vector versions of uni<uint32_t>, which give the same integers for the
+// same random engine. Their members are compiled for their instruction set
+// whatever the compilation flags, but they must only be used on CPUs that
+// support it (see cpu_features). operator() and get_step() return vectors,
+// and can only be called from code compiled for the same instruction set.
+// fill() can be called from anywhere, and uni_dispatch selects the widest
+// version at runtime.
+//
+// This version only supports max < 2^31.
 template <>
-class uni<__m128i, false>
+class uni<sse42_lanes, false>
 {
 public:
 	typedef __m128i integer_type;
@@ -170,7 +200,8 @@ public:
 	}
 
 	template <class Engine>
-	uni(uint32_t const max, Engine const& rand_eng)
+	uni(uint32_t const max, Engine const& rand_eng):
+		_rem_perm(nullptr)
 	{
 		init(max, rand_eng);
 	}
@@ -188,7 +219,7 @@ public:
 	 * \param max defines the interval of the generated integers. max isn't included (between [0,max[).
 	 */
 	template <class Engine>
-	void init(uint32_t const max, Engine const& rand_eng)
+	LEELOO_TARGET("sse4.2") void init(uint32_t const max, Engine const& rand_eng)
 	{
 		const uint32_t intermediate_off = rand_eng(0, max-1);
 		const uint32_t cur_pos = rand_eng(0, max-1);
@@ -202,10 +233,10 @@ public:
 
 
 public:
-	__m128i operator()()
+	LEELOO_TARGET("sse4.2") __m128i operator()()
 	{
 		__m128i cur_pos = _cur_pos;
-		const __m128i res = residue(_mm_urem_epi32(_mm_add_epi32(residue(cur_pos), _intermediate_off), _max));
+		const __m128i res = residue(add_mod(residue(cur_pos), _intermediate_off));
 
 		cur_pos = _mm_add_epi32(cur_pos, _mm_set1_epi32(4));
 		const __m128i cmp = _mm_cmpgt_epi32(cur_pos, _mm_sub_epi32(_max, _mm_set1_epi32(1)));
@@ -216,20 +247,45 @@ public:
 		return res;
 	}
 
-	__m128i get_step(uint32_t const step) const
+	// Write the next n integers to out
+	LEELOO_TARGET("sse4.2") void fill(uint32_t* out, size_t const n)
+	{
+		size_t i;
+		for (i = 0; i+4 <= n; i += 4) {
+			_mm_storeu_si128((__m128i*) &out[i], (*this)());
+		}
+		if (i < n) {
+			uint32_t buf[4];
+			_mm_storeu_si128((__m128i*) buf, residue(add_mod(residue(_cur_pos), _intermediate_off)));
+			memcpy(&out[i], buf, (n-i)*sizeof(uint32_t));
+			// Only skip the written integers
+			_cur_pos = add_mod(_cur_pos, _mm_set1_epi32((n-i) % (uint32_t) _mm_cvtsi128_si32(_max)));
+		}
+	}
+
+	LEELOO_TARGET("sse4.2") __m128i get_step(uint32_t const step) const
 	{
 		__m128i cur_pos = _cur_pos;
 		cur_pos = _mm_add_epi32(cur_pos, _mm_set1_epi32(step*4));
 		const __m128i cmp = _mm_cmpgt_epi32(cur_pos, _mm_sub_epi32(_max, _mm_set1_epi32(1)));
 		cur_pos = reinterpret_cast<__m128i>(_mm_blendv_ps(reinterpret_cast<__m128>(cur_pos), reinterpret_cast<__m128>(_mm_sub_epi32(cur_pos, _max)), reinterpret_cast<__m128>(cmp)));
 
-		const __m128i res = residue(_mm_urem_epi32(_mm_add_epi32(residue(cur_pos), _intermediate_off), _max));
+		const __m128i res = residue(add_mod(residue(cur_pos), _intermediate_off));
 
 		return res;
 	}
 
 private:
-	integer_type residue(__m128i const v) const
+	// (a+b)%max, with a and b lower than max
+	LEELOO_TARGET("sse4.2") inline __m128i add_mod(__m128i const a, __m128i const b) const
+	{
+		const __m128i max_b = _mm_sub_epi32(_max, b);
+		// a >= max-b, as unsigned integers
+		const __m128i ge = _mm_cmpeq_epi32(_mm_max_epu32(a, max_b), a);
+		return _mm_blendv_epi8(_mm_add_epi32(a, b), _mm_sub_epi32(a, max_b), ge);
+	}
+
+	LEELOO_TARGET("sse4.2") integer_type residue(__m128i const v) const
 	{
 		const uint64_t prime = _prime;
 		__m128i prime_sse = _mm_set1_epi32(prime);
@@ -244,7 +300,7 @@ private:
 				vi = _rem_perm[org_v-prime];\
 			}\
 			else {\
-				vi = ((uint64_t) org_v * (uint64_t) org_v) % prime;\
+				vi = _prime_reducer.mul(org_v, org_v);\
 				if (org_v > prime_d2) {\
 					vi = prime - vi;\
 				}\
@@ -270,8 +326,8 @@ private:
 #define RESIDUE(resi, v_, cmp_)\
 		__m128i resi;\
 		resi = _mm_mul_epu32(v_, v_);\
-		tmp0 = _mm_extract_epi64(resi, 0) % prime;\
-		tmp1 = _mm_extract_epi64(resi, 1) % prime;\
+		tmp0 = _prime_reducer.reduce(_mm_extract_epi64(resi, 0));\
+		tmp1 = _prime_reducer.reduce(_mm_extract_epi64(resi, 1));\
 		resi = _mm_insert_epi64(_mm_insert_epi64(_mm_setzero_si128(), tmp0, 0), tmp1, 1);\
 		res_comp = _mm_sub_epi64(prime_sse, resi);\
 		resi = reinterpret_cast<__m128i>(_mm_blendv_pd(reinterpret_cast<__m128d>(resi), reinterpret_cast<__m128d>(res_comp), reinterpret_cast<__m128d>(cmp_)));
@@ -287,9 +343,10 @@ private:
 	}
 
 private:
-	void init_prime(uint32_t const max)
+	LEELOO_TARGET("sse4.2") void init_prime(uint32_t const max)
 	{
 		_prime = find_previous_matching_prime(max);
+		_prime_reducer.init(_prime);
 		_max = _mm_set1_epi32(max);
 	}
 
@@ -297,6 +354,7 @@ private:
 	void init_final_perm(Engine const& rand_eng)
 	{
 		// Generate a random permutation for the final numbers
+		free(_rem_perm);
 		const uint32_t rem = size_rem();
 		posix_memalign((void**) &_rem_perm, 16, rem*sizeof(integer_type));
 		assert(_rem_perm);
@@ -308,17 +366,464 @@ private:
 		                    [&rand_eng](uint32_t n) { return rand_eng(0, n-1); });
 	}
 	
-	inline uint32_t size_rem() const { return _mm_extract_epi32(_max, 0) - _prime; }
+	LEELOO_TARGET("sse4.2") inline uint32_t size_rem() const { return _mm_extract_epi32(_max, 0) - _prime; }
 
 private:
 	uint32_t _prime;
+	__impl::mod_reducer<uint32_t> _prime_reducer;
 	__m128i _max;
 	__m128i _intermediate_off;
 	uint32_t* _rem_perm;
 	__m128i _cur_pos;
 };
+// Former name of uni<sse42_lanes>. Vector types lose their attributes as
+// template arguments, hence the warning being silenced here.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+template <>
+class __attribute__((deprecated("use uni<sse42_lanes>"))) uni<__m128i, false>: public uni<sse42_lanes, false>
+{
+public:
+	using uni<sse42_lanes, false>::uni;
+};
+#pragma GCC diagnostic pop
+
+namespace __impl {
+
+// Vectors with no alignment requirement, for the members of the AVX2 and
+// AVX-512 versions. These classes can thus be allocated with new or stored in
+// containers, which don't honour over-aligned types before C++17. The members
+// are read with unaligned loads, which cost the same as aligned ones on CPUs
+// that support these instruction sets.
+typedef __m256i m256i_unaligned __attribute__((aligned(1)));
+typedef __m512i m512i_unaligned __attribute__((aligned(1)));
+
+// Prime, Barrett constant and final permutation of the AVX2 and AVX-512
+// versions, which generate 32-bit integers.
+class uni_vector_base
+{
+protected:
+	uni_vector_base():
+		_rem_perm(nullptr)
+	{ }
+
+	uni_vector_base(uni_vector_base const&) = delete;
+	uni_vector_base& operator=(uni_vector_base const&) = delete;
+
+	~uni_vector_base()
+	{
+		free(_rem_perm);
+	}
+
+protected:
+	void init_prime(uint32_t const max)
+	{
+		_max = max;
+		_prime = find_previous_matching_prime(max);
+		_prime_reducer.init(_prime);
+	}
+
+	template <class Engine>
+	void init_final_perm(Engine const& rand_eng)
+	{
+		// Generate a random permutation for the final numbers
+		free(_rem_perm);
+		const uint32_t rem = _max-_prime;
+		posix_memalign((void**) &_rem_perm, 64, rem*sizeof(uint32_t));
+		assert(_rem_perm);
+		for (uint32_t i = 0; i < rem; i++) {
+			_rem_perm[i] = _prime + i;
+		}
+
+		std::random_shuffle(&_rem_perm[0], &_rem_perm[rem],
+		                    [&rand_eng](uint32_t n) { return rand_eng(0, n-1); });
+	}
+
+	// The n positions following pos
+	void consecutive_positions(uint32_t* out, uint32_t const pos, size_t const n) const
+	{
+		for (size_t i = 0; i < n; i++) {
+			out[i] = ((uint64_t) pos + i) % _max;
+		}
+	}
+
+protected:
+	uint32_t _max;
+	uint32_t _prime;
+	mod_reducer<uint32_t> _prime_reducer;
+	uint32_t* _rem_perm;
+};
+
+} // __impl
+
+template <>
+class uni<avx2_lanes, false>: private __impl::uni_vector_base
+{
+public:
+	typedef __m256i integer_type;
+	static constexpr size_t lanes = 8;
+
+public:
+	uni()
+	{ }
+
+	template <class Engine>
+	uni(uint32_t const max, Engine const& rand_eng)
+	{
+		init(max, rand_eng);
+	}
+
+public:
+	/*! Construct a Unique Random Integers (UNI) object, whose vectors hold 8
+	 * consecutive integers of the sequence.
+	 *
+	 * \param max defines the interval of the generated integers. max isn't included (between [0,max[).
+	 */
+	template <class Engine>
+	LEELOO_TARGET("avx2") void init(uint32_t const max, Engine const& rand_eng)
+	{
+		const uint32_t intermediate_off = rand_eng(0, max-1);
+		const uint32_t cur_pos = rand_eng(0, max-1);
+
+		init_prime(max);
+		init_final_perm(rand_eng);
+
+		const uint64_t inv = _prime_reducer.inv();
+		_max_v = _mm256_set1_epi32(max);
+		_prime_v = _mm256_set1_epi32(_prime);
+		_prime_half_p1 = _mm256_set1_epi32((_prime >> 1) + 1);
+		_prime64 = _mm256_set1_epi64x(_prime);
+		_prime64_m1 = _mm256_set1_epi64x((int64_t) _prime - 1);
+		_inv_lo = _mm256_set1_epi64x(inv & 0xFFFFFFFF);
+		_inv_hi = _mm256_set1_epi64x(inv >> 32);
+		_intermediate_off = _mm256_set1_epi32(intermediate_off);
+		_step = _mm256_set1_epi32(lanes % max);
+
+		uint32_t pos[lanes];
+		consecutive_positions(pos, cur_pos, lanes);
+		_cur_pos = _mm256_loadu_si256((__m256i const*) pos);
+	}
+
+	inline uint32_t max() const { return _max; }
+
+public:
+	LEELOO_TARGET("avx2") __m256i operator()()
+	{
+		const __m256i res = generate(_cur_pos);
+		_cur_pos = add_mod(_cur_pos, _step);
+		return res;
+	}
+
+	LEELOO_TARGET("avx2") __m256i get_step(uint32_t const step) const
+	{
+		uint32_t pos[lanes];
+		consecutive_positions(pos, ((uint64_t) (uint32_t) _mm256_cvtsi256_si32(_cur_pos) + (uint64_t) step*lanes) % _max, lanes);
+		return generate(_mm256_loadu_si256((__m256i const*) pos));
+	}
+
+	// Write the next n integers to out
+	LEELOO_TARGET("avx2") void fill(uint32_t* out, size_t const n)
+	{
+		size_t i;
+		for (i = 0; i+lanes <= n; i += lanes) {
+			_mm256_storeu_si256((__m256i*) &out[i], (*this)());
+		}
+		if (i < n) {
+			uint32_t buf[lanes];
+			_mm256_storeu_si256((__m256i*) buf, generate(_cur_pos));
+			memcpy(&out[i], buf, (n-i)*sizeof(uint32_t));
+			// Only skip the written integers
+			_cur_pos = add_mod(_cur_pos, _mm256_set1_epi32((n-i) % _max));
+		}
+	}
+
+private:
+	LEELOO_TARGET("avx2") inline __m256i generate(__m256i const pos) const
+	{
+		return residue(add_mod(residue(pos), _intermediate_off));
+	}
+
+	// (a+b)%max, with a and b lower than max
+	LEELOO_TARGET("avx2") inline __m256i add_mod(__m256i const a, __m256i const b) const
+	{
+		const __m256i max_b = _mm256_sub_epi32(_max_v, b);
+		// a >= max-b, as unsigned integers
+		const __m256i ge = _mm256_cmpeq_epi32(_mm256_max_epu32(a, max_b), a);
+		return _mm256_blendv_epi8(_mm256_add_epi32(a, b), _mm256_sub_epi32(a, max_b), ge);
+	}
+
+	// Barrett reduction of the 64-bit integers x, lower than prime^2
+	LEELOO_TARGET("avx2") inline __m256i reduce(__m256i const x) const
+	{
+		// (x*inv)>>64, without the lowest partial product and the carries.
+		// This underestimates the quotient by at most 3.
+		const __m256i x_hi = _mm256_srli_epi64(x, 32);
+		__m256i q = _mm256_mul_epu32(x_hi, _inv_hi);
+		q = _mm256_add_epi64(q, _mm256_srli_epi64(_mm256_mul_epu32(x_hi, _inv_lo), 32));
+		q = _mm256_add_epi64(q, _mm256_srli_epi64(_mm256_mul_epu32(x, _inv_hi), 32));
+		__m256i r = _mm256_sub_epi64(x, _mm256_mul_epu32(q, _prime64));
+		for (int i = 0; i < 3; i++) {
+			const __m256i ge = _mm256_cmpgt_epi64(r, _prime64_m1);
+			r = _mm256_sub_epi64(r, _mm256_and_si256(ge, _prime64));
+		}
+		return r;
+	}
+
+	LEELOO_TARGET("avx2") __m256i residue(__m256i const v) const
+	{
+		// Squares of the even and odd lanes, as 64-bit integers
+		const __m256i v_odd = _mm256_srli_epi64(v, 32);
+		const __m256i res_even = reduce(_mm256_mul_epu32(v, v));
+		const __m256i res_odd = reduce(_mm256_mul_epu32(v_odd, v_odd));
+		__m256i res = _mm256_blend_epi32(res_even, _mm256_slli_epi64(res_odd, 32), 0xAA);
+
+		// v > prime/2
+		const __m256i gt_half = _mm256_cmpeq_epi32(_mm256_max_epu32(v, _prime_half_p1), v);
+		res = _mm256_blendv_epi8(res, _mm256_sub_epi32(_prime_v, res), gt_half);
+
+		// Use the final permutation for v >= prime
+		const __m256i rem = _mm256_cmpeq_epi32(_mm256_max_epu32(v, _prime_v), v);
+		if (!_mm256_testz_si256(rem, rem)) {
+			res = _mm256_mask_i32gather_epi32(res, (int const*) _rem_perm, _mm256_sub_epi32(v, _prime_v), rem, 4);
+		}
+		return res;
+	}
+
+private:
+	__impl::m256i_unaligned _max_v;
+	__impl::m256i_unaligned _prime_v;
+	__impl::m256i_unaligned _prime_half_p1;
+	__impl::m256i_unaligned _prime64;
+	__impl::m256i_unaligned _prime64_m1;
+	__impl::m256i_unaligned _inv_lo;
+	__impl::m256i_unaligned _inv_hi;
+	__impl::m256i_unaligned _intermediate_off;
+	__impl::m256i_unaligned _step;
+	__impl::m256i_unaligned _cur_pos;
+};
+
+// GCC's AVX-512 intrinsics start from self-initialised undefined vectors,
+// which triggers false -Wmaybe-uninitialized warnings once inlined
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+template <>
+class uni<avx512_lanes, false>: private __impl::uni_vector_base
+{
+public:
+	typedef __m512i integer_type;
+	static constexpr size_t lanes = 16;
+
+public:
+	uni()
+	{ }
+
+	template <class Engine>
+	uni(uint32_t const max, Engine const& rand_eng)
+	{
+		init(max, rand_eng);
+	}
+
+public:
+	/*! Construct a Unique Random Integers (UNI) object, whose vectors hold 16
+	 * consecutive integers of the sequence.
+	 *
+	 * \param max defines the interval of the generated integers. max isn't included (between [0,max[).
+	 */
+	template <class Engine>
+	LEELOO_TARGET("avx512f") void init(uint32_t const max, Engine const& rand_eng)
+	{
+		const uint32_t intermediate_off = rand_eng(0, max-1);
+		const uint32_t cur_pos = rand_eng(0, max-1);
+
+		init_prime(max);
+		init_final_perm(rand_eng);
+
+		const uint64_t inv = _prime_reducer.inv();
+		_max_v = _mm512_set1_epi32(max);
+		_prime_v = _mm512_set1_epi32(_prime);
+		_prime_half = _mm512_set1_epi32(_prime >> 1);
+		_prime64 = _mm512_set1_epi64(_prime);
+		_inv_lo = _mm512_set1_epi64(inv & 0xFFFFFFFF);
+		_inv_hi = _mm512_set1_epi64(inv >> 32);
+		_intermediate_off = _mm512_set1_epi32(intermediate_off);
+		_step = _mm512_set1_epi32(lanes % max);
+
+		uint32_t pos[lanes];
+		consecutive_positions(pos, cur_pos, lanes);
+		_cur_pos = _mm512_loadu_si512(pos);
+	}
+
+	inline uint32_t max() const { return _max; }
+
+public:
+	LEELOO_TARGET("avx512f") __m512i operator()()
+	{
+		const __m512i res = generate(_cur_pos);
+		_cur_pos = add_mod(_cur_pos, _step);
+		return res;
+	}
+
+	LEELOO_TARGET("avx512f") __m512i get_step(uint32_t const step) const
+	{
+		uint32_t pos[lanes];
+		consecutive_positions(pos, ((uint64_t) (uint32_t) _mm512_cvtsi512_si32(_cur_pos) + (uint64_t) step*lanes) % _max, lanes);
+		return generate(_mm512_loadu_si512(pos));
+	}
+
+	// Write the next n integers to out
+	LEELOO_TARGET("avx512f") void fill(uint32_t* out, size_t const n)
+	{
+		size_t i;
+		for (i = 0; i+lanes <= n; i += lanes) {
+			_mm512_storeu_si512(&out[i], (*this)());
+		}
+		if (i < n) {
+			_mm512_mask_storeu_epi32(&out[i], (__mmask16) ((1U << (n-i))-1), generate(_cur_pos));
+			// Only skip the written integers
+			_cur_pos = add_mod(_cur_pos, _mm512_set1_epi32((n-i) % _max));
+		}
+	}
+
+private:
+	LEELOO_TARGET("avx512f") inline __m512i generate(__m512i const pos) const
+	{
+		return residue(add_mod(residue(pos), _intermediate_off));
+	}
+
+	// (a+b)%max, with a and b lower than max
+	LEELOO_TARGET("avx512f") inline __m512i add_mod(__m512i const a, __m512i const b) const
+	{
+		const __m512i max_b = _mm512_sub_epi32(_max_v, b);
+		return _mm512_mask_sub_epi32(_mm512_add_epi32(a, b), _mm512_cmpge_epu32_mask(a, max_b), a, max_b);
+	}
+
+	// Barrett reduction of the 64-bit integers x, lower than prime^2
+	LEELOO_TARGET("avx512f") inline __m512i reduce(__m512i const x) const
+	{
+		// (x*inv)>>64, without the lowest partial product and the carries.
+		// This underestimates the quotient by at most 3.
+		const __m512i x_hi = _mm512_srli_epi64(x, 32);
+		__m512i q = _mm512_mul_epu32(x_hi, _inv_hi);
+		q = _mm512_add_epi64(q, _mm512_srli_epi64(_mm512_mul_epu32(x_hi, _inv_lo), 32));
+		q = _mm512_add_epi64(q, _mm512_srli_epi64(_mm512_mul_epu32(x, _inv_hi), 32));
+		__m512i r = _mm512_sub_epi64(x, _mm512_mul_epu32(q, _prime64));
+		for (int i = 0; i < 3; i++) {
+			r = _mm512_mask_sub_epi64(r, _mm512_cmpge_epu64_mask(r, _prime64), r, _prime64);
+		}
+		return r;
+	}
+
+	LEELOO_TARGET("avx512f") __m512i residue(__m512i const v) const
+	{
+		// Squares of the even and odd lanes, as 64-bit integers
+		const __m512i v_odd = _mm512_srli_epi64(v, 32);
+		const __m512i res_even = reduce(_mm512_mul_epu32(v, v));
+		const __m512i res_odd = reduce(_mm512_mul_epu32(v_odd, v_odd));
+		__m512i res = _mm512_mask_blend_epi32(0xAAAA, res_even, _mm512_slli_epi64(res_odd, 32));
+
+		res = _mm512_mask_sub_epi32(res, _mm512_cmpgt_epu32_mask(v, _prime_half), _prime_v, res);
+
+		// Use the final permutation for v >= prime
+		const __mmask16 rem = _mm512_cmpge_epu32_mask(v, _prime_v);
+		if (rem) {
+			res = _mm512_mask_i32gather_epi32(res, rem, _mm512_sub_epi32(v, _prime_v), _rem_perm, 4);
+		}
+		return res;
+	}
+
+private:
+	__impl::m512i_unaligned _max_v;
+	__impl::m512i_unaligned _prime_v;
+	__impl::m512i_unaligned _prime_half;
+	__impl::m512i_unaligned _prime64;
+	__impl::m512i_unaligned _inv_lo;
+	__impl::m512i_unaligned _inv_hi;
+	__impl::m512i_unaligned _intermediate_off;
+	__impl::m512i_unaligned _step;
+	__impl::m512i_unaligned _cur_pos;
+};
+#ifndef __clang__
+#pragma GCC diagnostic pop
 #endif
 
+
+/*! Generates the same integers as uni<uint32_t>, with the widest vector
+ * version supported by the CPU, chosen at runtime. It can be allocated with
+ * new, as it doesn't need more than the alignment of malloc.
+ */
+class uni_dispatch
+{
+public:
+	uni_dispatch():
+		_level(cpu_features::simd_scalar),
+		_max(0)
+	{ }
+
+public:
+	/*! Construct a Unique Random Integers (UNI) object.
+	 *
+	 * \param max defines the interval of the generated integers. max isn't included (between [0,max[).
+	 */
+	template <class Engine>
+	void init(uint32_t const max, Engine const& rand_eng)
+	{
+		_max = max;
+		_level = cpu_features::level();
+		if ((_level == cpu_features::simd_sse42) && (max > 0x7FFFFFFFU)) {
+			_level = cpu_features::simd_scalar;
+		}
+
+		switch (_level) {
+		case cpu_features::simd_avx512:
+			_uni_avx512.init(max, rand_eng);
+			break;
+		case cpu_features::simd_avx2:
+			_uni_avx2.init(max, rand_eng);
+			break;
+		case cpu_features::simd_sse42:
+			_uni_sse.init(max, rand_eng);
+			break;
+		default:
+			_uni.init(max, rand_eng);
+			break;
+		}
+	}
+
+	// Write the next n integers to out
+	void fill(uint32_t* out, size_t const n)
+	{
+		switch (_level) {
+		case cpu_features::simd_avx512:
+			_uni_avx512.fill(out, n);
+			break;
+		case cpu_features::simd_avx2:
+			_uni_avx2.fill(out, n);
+			break;
+		case cpu_features::simd_sse42:
+			_uni_sse.fill(out, n);
+			break;
+		default:
+			_uni.fill(out, n);
+			break;
+		}
+	}
+
+	inline uint32_t max() const { return _max; }
+	inline cpu_features::simd_level level() const { return _level; }
+
+private:
+	cpu_features::simd_level _level;
+	uint32_t _max;
+	uni<uint32_t> _uni;
+	uni<sse42_lanes> _uni_sse;
+	uni<avx2_lanes> _uni_avx2;
+	uni<avx512_lanes> _uni_avx512;
+};
+
+static_assert(alignof(uni_dispatch) <= 16, "uni_dispatch must not need more alignment than malloc gives.");
+
 }
 
 #endif
@@ -52,7 +52,7 @@ template <class Integer, bool atomic = false>
 class uprng
 {
 	static_assert(std::is_signed<Integer>::value == false, "Integer must be an unsigned integer type.");
-	static_assert(sizeof(Integer) <= 4, "Integers wider than 32-bit integers aren't supported.");
+	static_assert(sizeof(Integer) <= 8, "Integers wider than 64-bit integers aren't supported.");
 
 public:
 	typedef Integer integer_type;
@@ -79,8 +79,10 @@ public:
 	 * \param max defines the interval of the generated integers. max isn't included (between [0,max[).
 	 */
 	template <class Engine>
-	void init(integer_type const max, Engine& rand_eng)
+	void init(integer_type const max, Engine& rand_eng_)
 	{
+		// The engine may have been created for a narrower type
+		typename Engine::template rebond<integer_type>::result rand_eng(rand_eng_);
 		_max = max;
 
 		_a = rand_eng(1, max-1);
@@ -90,8 +92,6 @@ public:
 		_c = random_prime_with(_prime-1, rand_eng);
 		_n = rand_eng(1, 4);
 
-		std::cout << max << " " << _prime << " " << _a << " " << _b << " " << _c << " " << _n << std::endl;
-
 		_cur_step = 0;
 	}
 
@@ -127,7 +127,7 @@ private:
 
 	inline static integer_type l(integer_type const X, integer_type const a, integer_type const b, integer_type const p)
 	{
-		return ((uint64_t)a*(uint64_t)X+(uint64_t)b)%p;
+		return add_mod(mul_mod(a, X, p), b, p);
 	}
 
 	inline static integer_type g(integer_type const X, integer_type const c, integer_type const p)
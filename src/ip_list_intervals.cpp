@@ -29,7 +29,26 @@
 #include <leeloo/ip_list_intervals.h>
 #include <leeloo/ips_parser.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+
+// Minimum number of bytes parsed by a single task of add_many/remove_many
+static constexpr size_t parse_grain_size = 256*1024;
+
+namespace {
+
+struct parse_result
+{
+	leeloo::ip_list_intervals list;
+	std::vector<size_t> invalid;
+};
+
+}
 
 template <bool exclude>
 static bool __insert(leeloo::ip_list_intervals& obj, const char* str_interval)
@@ -37,6 +56,54 @@ static bool __insert(leeloo::ip_list_intervals& obj, const char* str_interval)
 	return leeloo::ips_parser::parse_ips<exclude>(obj, str_interval);
 }
 
+template <bool exclude>
+static std::vector<size_t> __insert_many(leeloo::ip_list_intervals& obj, const char* buf, size_t const len, char const sep)
+{
+	// Each thread parses the ranges into its own list, which are then
+	// concatenated
+	tbb::enumerable_thread_specific<parse_result> results;
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, len, parse_grain_size),
+		[buf, len, sep, &results](tbb::blocked_range<size_t> const& r)
+		{
+			parse_result& res = results.local();
+			// A task parses the ranges that start in its range of bytes
+			size_t pos = r.begin();
+			if ((pos > 0) && (buf[pos-1] != sep)) {
+				const char* const next = (const char*) memchr(buf + pos, sep, len - pos);
+				if (next == nullptr) {
+					return;
+				}
+				pos = (next - buf) + 1;
+			}
+			while (pos < r.end()) {
+				const char* const str = buf + pos;
+				const char* const next = (const char*) memchr(str, sep, len - pos);
+				const size_t size = (next == nullptr) ? (len - pos) : (next - str);
+				// Removed ranges are also added to the local lists, and then
+				// removed from obj
+				if (!leeloo::ips_parser::parse_ips_add(res.list, str, size)) {
+					res.invalid.push_back(pos);
+				}
+				pos += size + 1;
+			}
+		});
+
+	std::vector<leeloo::ip_list_intervals::interval_base_type const*> lists;
+	std::vector<size_t> invalid;
+	for (parse_result const& res: results) {
+		lists.push_back(&res.list);
+		invalid.insert(invalid.end(), res.invalid.begin(), res.invalid.end());
+	}
+	if (exclude) {
+		obj.remove_lists(lists);
+	}
+	else {
+		obj.add_lists(lists);
+	}
+	std::sort(invalid.begin(), invalid.end());
+	return invalid;
+}
+
 bool leeloo::ip_list_intervals::add(const char* str_interval)
 {
 	return __insert<false>(*this, str_interval);
@@ -47,6 +114,16 @@ bool leeloo::ip_list_intervals::remove(const char* str_interval)
 	return __insert<true>(*this, str_interval);
 }
 
+std::vector<size_t> leeloo::ip_list_intervals::add_many(const char* buf, size_t const len, char const sep)
+{
+	return __insert_many<false>(*this, buf, len, sep);
+}
+
+std::vector<size_t> leeloo::ip_list_intervals::remove_many(const char* buf, size_t const len, char const sep)
+{
+	return __insert_many<true>(*this, buf, len, sep);
+}
+
 bool leeloo::ip_list_intervals::contains(const char* ip_str) const
 {
 	bool valid = false;
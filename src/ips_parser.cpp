@@ -26,11 +26,16 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <leeloo/cpu_features.h>
 #include <leeloo/ips_parser.h>
 #include <leeloo/ip_list_intervals.h>
 
 #include <string.h>
 
+#include <algorithm>
+
+#include <x86intrin.h>
+
 // This is a closed interval [min, max]
 struct byte_interval
 {
@@ -50,17 +55,6 @@ struct byte_interval
 	uint8_t max;
 };
 
-static size_t count_char_buf(const char* str, size_t size, const char c)
-{
-	size_t ret = 0;
-	for (size_t i = 0; i < size; i++) {
-		if (str[i] == c) {
-			ret++;
-		}
-	}
-	return ret;
-}
-
 static inline uint32_t atoi3(const char* str, const size_t len_int)
 {
 	static int pow10[] = {1, 10, 100};
@@ -105,7 +99,7 @@ static inline uint32_t atoi3_trim(const char* str, const size_t len_int)
 }
 
 
-uint32_t leeloo::ips_parser::ipv4toi(const char* str, const size_t size, bool& valid, int min_dots)
+static uint32_t ipv4toi_scalar(const char* str, const size_t size, bool& valid, int min_dots)
 {
 	if (size == 0) {
 		valid = false;
@@ -115,14 +109,15 @@ uint32_t leeloo::ips_parser::ipv4toi(const char* str, const size_t size, bool& v
 	uint32_t ret = 0;
 	int cur_idx = 3;
 	size_t i;
-	for (i = 0; i <= size; i++) {
+	for (i = 0; i < size; i++) {
 		if (!isspace(str[i])) {
 			break;
 		}
 	}
 	size_t start_idx = i;
 	for (; i <= size; i++) {
-		const char c = str[i];
+		// str doesn't need to be null-terminated
+		const char c = (i < size) ? str[i] : 0;
 		if (c == '.' || (i == size)) {
 			if (cur_idx < 0) {
 				valid = false;
@@ -154,13 +149,300 @@ uint32_t leeloo::ips_parser::ipv4toi(const char* str, const size_t size, bool& v
 	return ret;
 }
 
+namespace {
+
+// Shuffle masks that move the digits of the four octets of a dotted quad to
+// the lanes [hundreds, tens, units, 0] of four 32-bit integers, for each
+// combination of octet lengths (1 to 3 digits each).
+struct ipv4_shuffles
+{
+	ipv4_shuffles()
+	{
+		for (unsigned int idx = 0; idx < 81; idx++) {
+			unsigned int lens[4] = {idx/27 + 1, (idx/9)%3 + 1, (idx/3)%3 + 1, idx%3 + 1};
+			uint8_t* const m = masks[idx];
+			memset(m, 0x80, 16);
+			unsigned int pos = 0;
+			for (unsigned int o = 0; o < 4; o++) {
+				const unsigned int len = lens[o];
+				for (unsigned int d = 0; d < len; d++) {
+					m[4*o + 3 - len + d] = pos + d;
+				}
+				pos += len + 1;
+			}
+		}
+	}
+
+	alignas(16) uint8_t masks[81][16];
+};
+
+ipv4_shuffles const& get_ipv4_shuffles()
+{
+	static ipv4_shuffles ret;
+	return ret;
+}
+
+// Parse a dotted quad made only of digits and dots that is in the first size
+// bytes of v. Return false if str isn't such a dotted quad, in which case the
+// scalar version must be used.
+LEELOO_TARGET("ssse3") inline bool ipv4toi_simd(__m128i const v, size_t const size, uint32_t& ip)
+{
+	if ((size < 7) || (size > 15)) {
+		return false;
+	}
+
+	const __m128i iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i in_str = _mm_cmpgt_epi8(_mm_set1_epi8(size), iota);
+	const __m128i dots = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')), in_str);
+	const __m128i digits_val = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+	// Unsigned digits_val <= 9
+	const __m128i digits = _mm_and_si128(_mm_cmpeq_epi8(_mm_min_epu8(digits_val, _mm_set1_epi8(9)), digits_val), in_str);
+
+	const unsigned int dots_mask = _mm_movemask_epi8(dots);
+	const unsigned int valid_mask = (1U<<size)-1;
+	if (((dots_mask | _mm_movemask_epi8(digits)) != valid_mask) || (__builtin_popcount(dots_mask) != 3)) {
+		return false;
+	}
+
+	// Octet lengths, from the positions of the dots
+	const unsigned int d0 = __builtin_ctz(dots_mask);
+	const unsigned int d1 = __builtin_ctz(dots_mask & (dots_mask-1));
+	const unsigned int d2 = 31 - __builtin_clz(dots_mask);
+	const unsigned int l0 = d0;
+	const unsigned int l1 = d1 - d0 - 1;
+	const unsigned int l2 = d2 - d1 - 1;
+	const unsigned int l3 = size - d2 - 1;
+	if ((l0 - 1) > 2 || (l1 - 1) > 2 || (l2 - 1) > 2 || (l3 - 1) > 2) {
+		return false;
+	}
+	const unsigned int idx = (l0-1)*27 + (l1-1)*9 + (l2-1)*3 + (l3-1);
+
+	const __m128i shuffle = _mm_load_si128((__m128i const*) get_ipv4_shuffles().masks[idx]);
+	const __m128i octets_digits = _mm_shuffle_epi8(digits_val, shuffle);
+	// [h*100 + t*10, u] for each octet, and then h*100 + t*10 + u
+	const __m128i partial = _mm_maddubs_epi16(octets_digits, _mm_setr_epi8(100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0));
+	const __m128i octets = _mm_madd_epi16(partial, _mm_set1_epi16(1));
+	if (_mm_movemask_epi8(_mm_cmpgt_epi32(octets, _mm_set1_epi32(255))) != 0) {
+		return false;
+	}
+	// Most significant octet first
+	ip = _mm_cvtsi128_si32(_mm_shuffle_epi8(octets, _mm_setr_epi8(12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)));
+	return true;
+}
+
+// Load the 16 bytes at str, without crossing a page boundary after
+// str[size-1].
+inline __m128i load_ipv4(const char* str, size_t const size)
+{
+	if ((((uintptr_t) str) & 4095) <= 4096-16) {
+		return _mm_loadu_si128((__m128i const*) str);
+	}
+	char buf[16] = {0};
+	memcpy(buf, str, std::min(size, (size_t) 16));
+	return _mm_loadu_si128((__m128i const*) buf);
+}
+
+LEELOO_TARGET("ssse3") uint32_t ipv4toi_ssse3(const char* str, const size_t size, bool& valid, int min_dots)
+{
+	uint32_t ip;
+	if ((size <= 15) && ipv4toi_simd(load_ipv4(str, size), size, ip)) {
+		valid = true;
+		return ip;
+	}
+	return ipv4toi_scalar(str, size, valid, min_dots);
+}
+
+// Parse the line at the beginning of buf with the scalar parser, and return
+// its length
+inline size_t ipv4toi_line_scalar(const char* line, size_t const rem, uint32_t& ip, uint8_t& valid)
+{
+	const char* const end = (const char*) memchr(line, '\n', rem);
+	const size_t len = (end == nullptr) ? rem : (end - line);
+	bool v;
+	ip = ipv4toi_scalar(line, len, v, 3);
+	valid = v;
+	return len;
+}
+
+size_t ipv4toi_batch_scalar(const char* buf, size_t const size, uint32_t* ips, uint8_t* valid, size_t const n, size_t& pos)
+{
+	size_t i;
+	for (i = 0; (i < n) && (pos < size); i++) {
+		pos += ipv4toi_line_scalar(buf + pos, size - pos, ips[i], valid[i]) + 1;
+	}
+	return i;
+}
+
+LEELOO_TARGET("ssse3") size_t ipv4toi_batch_ssse3(const char* buf, size_t const size, uint32_t* ips, uint8_t* valid, size_t const n, size_t& pos)
+{
+	size_t i;
+	for (i = 0; (i < n) && (pos < size); i++) {
+		const char* const line = buf + pos;
+		const size_t rem = size - pos;
+		if (rem >= 16) {
+			// The line is found and parsed with the same load
+			const __m128i v = _mm_loadu_si128((__m128i const*) line);
+			const unsigned int nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+			if (nl != 0) {
+				const size_t len = __builtin_ctz(nl);
+				if (ipv4toi_simd(v, len, ips[i])) {
+					valid[i] = true;
+					pos += len + 1;
+					continue;
+				}
+			}
+		}
+		pos += ipv4toi_line_scalar(line, rem, ips[i], valid[i]) + 1;
+	}
+	return i;
+}
+
+// Kernels chosen on first use according to the CPU, so that they can be
+// called from static initialisers. The SSSE3 kernels are part of the
+// simd_sse42 level.
+typedef uint32_t (*ipv4toi_fn)(const char*, const size_t, bool&, int);
+typedef size_t (*ipv4toi_batch_fn)(const char*, size_t const, uint32_t*, uint8_t*, size_t const, size_t&);
+
+ipv4toi_fn ipv4toi_kernel()
+{
+	static const ipv4toi_fn ret = leeloo::cpu_features::supports(leeloo::cpu_features::simd_sse42) ? ipv4toi_ssse3 : ipv4toi_scalar;
+	return ret;
+}
+
+ipv4toi_batch_fn ipv4toi_batch_kernel()
+{
+	static const ipv4toi_batch_fn ret = leeloo::cpu_features::supports(leeloo::cpu_features::simd_sse42) ? ipv4toi_batch_ssse3 : ipv4toi_batch_scalar;
+	return ret;
+}
+
+}
+
+uint32_t leeloo::ips_parser::ipv4toi(const char* str, const size_t size, bool& valid, int min_dots)
+{
+	return ipv4toi_kernel()(str, size, valid, min_dots);
+}
+
 uint32_t leeloo::ips_parser::ipv4toi(const char* str, bool& valid, int min_dots)
 {
 	return ipv4toi(str, strlen(str), valid, min_dots);
 }
 
+size_t leeloo::ips_parser::ipv4toi_batch(const char* buf, size_t const size, uint32_t* ips, uint8_t* valid, size_t const n, size_t* consumed)
+{
+	size_t pos = 0;
+	const size_t ret = ipv4toi_batch_kernel()(buf, size, ips, valid, n, pos);
+	if (consumed != nullptr) {
+		*consumed = std::min(pos, size);
+	}
+	return ret;
+}
+
+// Positions of the separators of a string, found in a single scan
+struct separators
+{
+	static constexpr size_t npos = (size_t) -1;
+
+	// The scan stops at max_size or at the first null character
+	separators(const char* str, size_t const max_size):
+		ndashes(0),
+		nslashes(0),
+		ndots(0),
+		first_dash(npos),
+		first_slash(npos)
+	{
+		for (size_t i = 0; i < 4; i++) {
+			octet_dash[i] = npos;
+		}
+		size_t i;
+		char c;
+		for (i = 0; (i < max_size) && ((c = str[i]) != 0); i++) {
+			switch (c) {
+				case '-':
+					if (ndashes == 0) {
+						first_dash = i;
+					}
+					if ((ndots < 4) && (octet_dash[ndots] == npos)) {
+						octet_dash[ndots] = i;
+					}
+					ndashes++;
+					break;
+				case '/':
+					if (nslashes == 0) {
+						first_slash = i;
+					}
+					nslashes++;
+					break;
+				case '.':
+					if (ndots < 3) {
+						dots[ndots] = i;
+					}
+					ndots++;
+					break;
+				default:
+					break;
+			}
+		}
+		size = i;
+	}
+
+	size_t size;
+	size_t ndashes;
+	size_t nslashes;
+	size_t ndots;
+	size_t first_dash;
+	size_t first_slash;
+	// Positions of the first three dots
+	size_t dots[3];
+	// Position of the first dash of each dot-separated part
+	size_t octet_dash[4];
+};
+
+// Parse "a" or "a-b" in str[0..size[, with 0 <= a, b <= 255
+static bool parse_byte_interval(const char* str, size_t const size, size_t const dash, byte_interval& ret)
+{
+	if (dash == separators::npos) {
+		const uint32_t byte = atoi3_trim(str, size);
+		if (byte > 0xFF) {
+			return false;
+		}
+		ret.set(byte, byte);
+	}
+	else {
+		const uint32_t byte_min = atoi3_trim(str, dash);
+		const uint32_t byte_max = atoi3_trim(str + dash + 1, size - (dash + 1));
+		if ((byte_min > 0xFF) || (byte_max > 0xFF)) {
+			return false;
+		}
+		ret.set(byte_min, byte_max);
+	}
+	return true;
+}
+
+// Same as strtol(str, nullptr, 10), without reading str[size] and beyond
+static long parse_long(const char* str, size_t const size)
+{
+	size_t i = 0;
+	while ((i < size) && isspace(str[i])) {
+		i++;
+	}
+	bool neg = false;
+	if ((i < size) && ((str[i] == '-') || (str[i] == '+'))) {
+		neg = (str[i] == '-');
+		i++;
+	}
+	long ret = 0;
+	for (; (i < size) && (str[i] >= '0') && (str[i] <= '9'); i++) {
+		ret = ret*10 + (str[i]-'0');
+		if (ret > 0xFFFF) {
+			// Larger than any valid value
+			break;
+		}
+	}
+	return neg ? -ret : ret;
+}
+
 template <bool exclude>
-static bool __parse_ips(leeloo::ip_list_intervals& l, const char* str)
+static bool __parse_ips(leeloo::ip_list_intervals& l, const char* str, size_t const max_size)
 {
 	// We need to support these formats:
 	// 10.0.1.0/24
@@ -169,14 +451,11 @@ static bool __parse_ips(leeloo::ip_list_intervals& l, const char* str)
 	// 10.4-5.8-11.0-255
 	// 10.0.1.4-10.2.4.10
 	
-	const size_t size_str = strlen(str);
-
-	// TODO: merge these two loops
-	const size_t ndashes = count_char_buf(str, size_str, '-');
-	const size_t nslashes = count_char_buf(str, size_str, '/');
+	const separators seps(str, max_size);
+	const size_t size_str = seps.size;
 
 	// Fast case with no slashes or dashes (simple IP)
-	if ((nslashes == 0) && (ndashes == 0)) {
+	if ((seps.nslashes == 0) && (seps.ndashes == 0)) {
 		// Just parse the IP
 		bool valid;
 		const uint32_t ip = leeloo::ips_parser::ipv4toi(str, size_str, valid);
@@ -188,58 +467,53 @@ static bool __parse_ips(leeloo::ip_list_intervals& l, const char* str)
 		return true;
 	}
 
-	if (ndashes == 1) {
-		if (nslashes > 0) {
-			return false;
-		}
+	if ((seps.nslashes > 1) || ((seps.nslashes > 0) && (seps.ndashes > 0))) {
+		return false;
+	}
 
+	if (seps.ndashes == 1) {
 		// We want to parse this:
 		// 10.0.1.4-10.2.4.10
 		// We support the fact that the interval could have been written the wrong way.
 		// (like 10.2.4.10-10.0.1.4)
-		const char* sep = strchr(str, '-');
-		if (*(sep+1) == 0) {
+		// If the first part isn't an IP, this is a byte interval (like
+		// 10.4-5.8.0), which is parsed below.
+		const size_t idx_sep = seps.first_dash;
+		if (idx_sep+1 == size_str) {
 			return false;
 		}
-		const size_t idx_sep = (uintptr_t)sep-(uintptr_t)str;
+		const char* sep = str + idx_sep;
 
 		bool valid = false;
 		uint32_t a = leeloo::ips_parser::ipv4toi(str, idx_sep, valid);
-		if (!valid) {
-			return false;
-		}
-		const size_t size_part2 = size_str-(idx_sep+1);
-		uint32_t b = leeloo::ips_parser::ipv4toi(sep+1, size_part2, valid);
-		if (!valid) {
-			// Check if this is just a number
-			b = atoi3(sep+1, size_part2);
-			if (b > 0xFF) {
-				return false;
+		if (valid) {
+			const size_t size_part2 = size_str-(idx_sep+1);
+			uint32_t b = leeloo::ips_parser::ipv4toi(sep+1, size_part2, valid);
+			if (!valid) {
+				// Check if this is just a number
+				b = atoi3(sep+1, size_part2);
+				if (b > 0xFF) {
+					return false;
+				}
+				b = (a & 0xFFFFFF00) | b;
 			}
-			b = (a & 0xFFFFFF00) | b;
-		}
-		if (a > b) {
-			std::swap(a, b);
+			if (a > b) {
+				std::swap(a, b);
+			}
+			l.insert<exclude>(a, b);
+			return true;
 		}
-		l.insert<exclude>(a, b);
-		return true;
-	}
-
-	if (nslashes > 1) {
-		return false;
 	}
 
-	if (ndashes == 0) {
-		const char* slash = strchr(str, '/');
-		if (!slash || strlen(slash) == 0) {
-			return false;
-		}
-		const int cidr = strtol(slash+1, nullptr, 10);
-		if (cidr < 0) {
+	else
+	if (seps.ndashes == 0) {
+		const size_t idx_slash = seps.first_slash;
+		const long cidr = parse_long(str + idx_slash + 1, size_str - (idx_slash + 1));
+		if ((cidr < 0) || (cidr > 32)) {
 			return false;
 		}
 		bool valid = false;
-		uint32_t ip_start = leeloo::ips_parser::ipv4toi(str, (uintptr_t)slash-(uintptr_t)str, valid, 0);
+		uint32_t ip_start = leeloo::ips_parser::ipv4toi(str, idx_slash, valid, 0);
 		if (!valid) {
 			return false;
 		}
@@ -249,70 +523,58 @@ static bool __parse_ips(leeloo::ip_list_intervals& l, const char* str)
 		return true;
 	}
 
-	// Parse recursively block by block (separated by '.')
+	// Byte intervals separated by three dots
+	if (seps.ndots != 3) {
+		return false;
+	}
 	byte_interval intervals[4];
-	const char* cur = str;
-	int cur_interval = 0;
-	const char* dot;
-	while (((dot = strchr(cur, '.')) != nullptr) && cur_interval < 4) {
-		//*dot = 0;
-		/*char* slash = strchr(cur, '/');
-		if (slash) {
-			// End of loop
-		}*/
-		const char* dash = (const char*) memchr(cur, '-', (uintptr_t)dot-(uintptr_t)cur);
-		if (dash) {
-			const int32_t byte_min = atoi3_trim(cur, (uintptr_t)dash-(uintptr_t)cur);
-			const int32_t byte_max = atoi3_trim(dash+1, (uintptr_t)dot-(uintptr_t)(dash+1));
-			if (byte_min == -1 || byte_max == -1) {
-				return false;
-			}
-			intervals[cur_interval].set(byte_min, byte_max);
-		}
-		else {
-			const int32_t byte = atoi3_trim(cur, (uintptr_t)dot-(uintptr_t)cur);
-			if (byte == -1) {
-				return false;
-			}
-			intervals[cur_interval].set(byte, byte);
+	size_t start = 0;
+	for (size_t i = 0; i < 4; i++) {
+		const size_t end = (i < 3) ? seps.dots[i] : size_str;
+		const size_t dash = seps.octet_dash[i];
+		if (!parse_byte_interval(str + start, end - start, (dash == separators::npos) ? dash : dash - start, intervals[i])) {
+			return false;
 		}
-		cur = dot+1;
-		cur_interval++;
+		start = end + 1;
 	}
 
-	// Check that 3 intervals have been found
-	if (cur_interval != 3) {
-		return false;
+	// The trailing bytes that cover all their values are merged with the
+	// last one that doesn't, so that each combination of the leading bytes
+	// gives a single interval.
+	int last = 3;
+	while ((last >= 0) && (intervals[last].min == 0) && (intervals[last].max == 0xFF)) {
+		last--;
+	}
+	if (last < 0) {
+		l.insert<exclude>(0, 0xFFFFFFFF);
+		return true;
 	}
+	const unsigned int shift = 8*(3-last);
+	const uint32_t low_mask = (1U << shift) - 1;
 
-	// Last one
-	const char* dash = strchr(cur, '-');
-	if (dash) {
-		const int32_t byte_min = atoi3_trim(cur, (uintptr_t)dash-(uintptr_t)cur);
-		const int32_t byte_max = atoi3_trim(dash+1, size_str-((uintptr_t)(dash+1)-(uintptr_t)str));
-		if (byte_min == -1 || byte_max == -1) {
-			return false;
-		}
-		intervals[cur_interval].set(byte_min, byte_max);
+	uint32_t cur[3];
+	for (int i = 0; i < last; i++) {
+		cur[i] = intervals[i].min;
 	}
-	else {
-		const int32_t byte = atoi3_trim(cur, (uintptr_t)dot-(uintptr_t)cur);
-		if (byte == -1) {
-			return false;
+	while (true) {
+		uint32_t ip_base = 0;
+		for (int i = 0; i < last; i++) {
+			ip_base |= cur[i] << (8*(3-i));
 		}
-		intervals[cur_interval].set(byte, byte);
-	}
-
-	// We got our intervals, let's create them
-	for (uint32_t a = intervals[0].min; a <= intervals[0].max; a++) {
-		for (uint32_t b = intervals[1].min; b <= intervals[1].max; b++) {
-			for (uint32_t c = intervals[2].min; c <= intervals[2].max; c++) {
-				const uint32_t ip_base = (a<<24) | (b<<16) | (c<<8);
-				const uint32_t ip_min = ip_base | intervals[3].min;
-				const uint32_t ip_max = ip_base | intervals[3].max;
-				l.insert<exclude>(ip_min, ip_max);
-			}
+		const uint32_t ip_min = ip_base | (((uint32_t) intervals[last].min) << shift);
+		const uint32_t ip_max = ip_base | (((uint32_t) intervals[last].max) << shift) | low_mask;
+		l.insert<exclude>(ip_min, ip_max);
+
+		// Next combination of the leading bytes
+		int i = last-1;
+		while ((i >= 0) && (cur[i] == intervals[i].max)) {
+			cur[i] = intervals[i].min;
+			i--;
+		}
+		if (i < 0) {
+			break;
 		}
+		cur[i]++;
 	}
 
 	return true;
@@ -320,10 +582,20 @@ static bool __parse_ips(leeloo::ip_list_intervals& l, const char* str)
 
 bool leeloo::ips_parser::parse_ips_add(ip_list_intervals& l, const char* str)
 {
-	return __parse_ips<false>(l, str);
+	return __parse_ips<false>(l, str, separators::npos);
+}
+
+bool leeloo::ips_parser::parse_ips_add(ip_list_intervals& l, const char* str, size_t const size)
+{
+	return __parse_ips<false>(l, str, size);
 }
 
 bool leeloo::ips_parser::parse_ips_remove(ip_list_intervals& l, const char* str)
 {
-	return __parse_ips<true>(l, str);
+	return __parse_ips<true>(l, str, separators::npos);
+}
+
+bool leeloo::ips_parser::parse_ips_remove(ip_list_intervals& l, const char* str, size_t const size)
+{
+	return __parse_ips<true>(l, str, size);
 }
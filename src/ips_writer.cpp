@@ -0,0 +1,223 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <leeloo/ips_writer.h>
+#include <leeloo/ip_list_intervals.h>
+
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+// Size of the output buffer
+static constexpr size_t write_buffer_size = 1<<20;
+// Longest line is "255.255.255.255-255.255.255.255\n", with 4 more bytes
+// for the unconditional copies of itoipv4
+static constexpr size_t max_line_size = 36;
+
+namespace {
+
+// Decimal digits of each byte value, padded to 4 bytes so that they can be
+// copied at once, followed by their number.
+struct byte_digits
+{
+	byte_digits()
+	{
+		memset(digits, 0, sizeof(digits));
+		for (unsigned int i = 0; i < 256; i++) {
+			char* const s = digits[i];
+			if (i >= 100) {
+				s[0] = '0' + i/100;
+				s[1] = '0' + (i/10)%10;
+				s[2] = '0' + i%10;
+				lens[i] = 3;
+			}
+			else
+			if (i >= 10) {
+				s[0] = '0' + i/10;
+				s[1] = '0' + i%10;
+				lens[i] = 2;
+			}
+			else {
+				s[0] = '0' + i;
+				lens[i] = 1;
+			}
+		}
+	}
+
+	char digits[256][4];
+	uint8_t lens[256];
+};
+
+byte_digits const& get_byte_digits()
+{
+	static byte_digits ret;
+	return ret;
+}
+
+inline size_t write_byte(byte_digits const& bd, unsigned int const v, char* str)
+{
+	memcpy(str, bd.digits[v], 4);
+	return bd.lens[v];
+}
+
+inline size_t write_ip(byte_digits const& bd, uint32_t const ip, char* str)
+{
+	size_t n = write_byte(bd, ip >> 24, str);
+	str[n++] = '.';
+	n += write_byte(bd, (ip >> 16) & 0xFF, str + n);
+	str[n++] = '.';
+	n += write_byte(bd, (ip >> 8) & 0xFF, str + n);
+	str[n++] = '.';
+	n += write_byte(bd, ip & 0xFF, str + n);
+	return n;
+}
+
+class fd_writer
+{
+public:
+	fd_writer(int fd):
+		_fd(fd),
+		_cur(0),
+		_bd(get_byte_digits())
+	{
+		if (fd == -1) {
+			errno = EBADF;
+			throw leeloo::file_exception();
+		}
+		_buf.resize(write_buffer_size);
+	}
+
+public:
+	// Room for at least max_line_size characters
+	inline char* line()
+	{
+		if (_cur + max_line_size > _buf.size()) {
+			flush();
+		}
+		return &_buf[_cur];
+	}
+
+	inline void commit(size_t const n) { _cur += n; }
+
+	inline byte_digits const& digits() const { return _bd; }
+
+	void flush()
+	{
+		size_t done = 0;
+		while (done < _cur) {
+			const ssize_t w = write(_fd, &_buf[done], _cur-done);
+			if (w < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw leeloo::file_exception();
+			}
+			done += w;
+		}
+		_cur = 0;
+	}
+
+private:
+	int _fd;
+	std::vector<char> _buf;
+	size_t _cur;
+	byte_digits const& _bd;
+};
+
+}
+
+size_t leeloo::ips_writer::itoipv4(uint32_t const ip, char* str)
+{
+	return write_ip(get_byte_digits(), ip, str);
+}
+
+void leeloo::ips_writer::write_cidr(int fd, ip_list_intervals const& l)
+{
+	fd_writer w(fd);
+	byte_digits const& bd = w.digits();
+	for (ip_interval const& it: l) {
+		// Largest aligned blocks that fit in [a, b[
+		uint64_t a = it.lower();
+		const uint64_t b = it.upper();
+		while (a < b) {
+			const unsigned int align = (a == 0) ? 32 : __builtin_ctzll(a);
+			const unsigned int fit = 63 - __builtin_clzll(b - a);
+			const unsigned int k = std::min(align, fit);
+			char* str = w.line();
+			size_t n = write_ip(bd, a, str);
+			str[n++] = '/';
+			n += write_byte(bd, 32-k, str + n);
+			str[n++] = '\n';
+			w.commit(n);
+			a += 1ULL << k;
+		}
+	}
+	w.flush();
+}
+
+void leeloo::ips_writer::write_ranges(int fd, ip_list_intervals const& l)
+{
+	fd_writer w(fd);
+	byte_digits const& bd = w.digits();
+	for (ip_interval const& it: l) {
+		char* str = w.line();
+		size_t n = write_ip(bd, it.lower(), str);
+		if (it.width() > 1) {
+			str[n++] = '-';
+			n += write_ip(bd, it.upper()-1, str + n);
+		}
+		str[n++] = '\n';
+		w.commit(n);
+	}
+	w.flush();
+}
+
+void leeloo::ips_writer::write_legacy(int fd, ip_list_intervals const& l)
+{
+	fd_writer w(fd);
+	byte_digits const& bd = w.digits();
+	for (ip_interval const& it: l) {
+		const uint32_t width = it.width();
+		char* str = w.line();
+		size_t n = write_ip(bd, it.lower(), str);
+		if (__builtin_popcount(width) == 1) {
+			str[n++] = '/';
+			n += write_byte(bd, 32-__builtin_ctz(width), str + n);
+		}
+		else {
+			str[n++] = '-';
+			n += write_ip(bd, it.upper(), str + n);
+		}
+		str[n++] = '\n';
+		w.commit(n);
+	}
+	w.flush();
+}
@@ -60,3 +60,11 @@ template void LEELOO_API leeloo::list_intervals_random<leeloo::list_intervals<le
 #endif
 
 #endif
+
+#ifdef LEELOO_INCLUDE_U64
+template class LEELOO_API leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t>;
+template class LEELOO_API leeloo::list_intervals_random<leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t>, leeloo::uni, false>;
+template void LEELOO_API leeloo::list_intervals_random<leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t>, leeloo::uni, false>::init<leeloo::random<uint64_t, boost::random::mt19937>>(leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t> const&, leeloo::random<uint64_t, boost::random::mt19937>&&);
+template class LEELOO_API leeloo::list_intervals_random_promise<leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t>, leeloo::uni, false>;
+template void LEELOO_API leeloo::list_intervals_random_promise<leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t>, leeloo::uni, false>::init<leeloo::random<uint64_t, boost::random::mt19937>>(leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t> const&, leeloo::random<uint64_t, boost::random::mt19937>&&);
+#endif
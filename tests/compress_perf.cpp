@@ -0,0 +1,99 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <string>
+
+#include <leeloo/interval.h>
+#include <leeloo/list_intervals.h>
+
+// Interval of type [a,b[
+typedef leeloo::list_intervals<leeloo::interval<uint32_t>, uint32_t> list_intervals;
+
+int main(int argc, char** argv)
+{
+	if (argc <= 2) {
+		std::cerr << "Usage: " << argv[0] << " n mean_size" << std::endl;
+		return 1;
+	}
+
+	const size_t n = atoll(argv[1]);
+	const size_t mean_size = atoll(argv[2]);
+
+	list_intervals list;
+	list.reserve(n);
+
+	srand(time(NULL));
+
+	std::cout << "Generate random intervals..." << std::endl;
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t a = rand();
+		const uint32_t b = a + 1 + (rand()%(2*mean_size));
+		list.add(a, b);
+	}
+	list.aggregate();
+	const size_t nintervals = list.intervals_count();
+	const size_t data_size = nintervals*sizeof(list_intervals::interval_type);
+	std::cout << "Done, " << nintervals << " intervals." << std::endl;
+
+	std::stringstream raw;
+	BENCH_START(dump_raw);
+	list.dump_stream(raw);
+	BENCH_END(dump_raw, "dump_stream", nintervals, sizeof(list_intervals::interval_type), 1, 1);
+
+	std::stringstream compressed;
+	BENCH_START(dump_compressed);
+	list.dump_compressed_stream(compressed);
+	BENCH_END(dump_compressed, "dump_compressed_stream", nintervals, sizeof(list_intervals::interval_type), 1, 1);
+
+	const size_t raw_size = raw.str().size();
+	const size_t compressed_size = compressed.str().size();
+	std::cout << "Raw size: " << raw_size << " bytes, compressed size: " << compressed_size << " bytes ("
+	          << (data_size > 0 ? (double) compressed_size*100.0/data_size : 0.0) << "% of the intervals)" << std::endl;
+
+	list_intervals list_raw;
+	BENCH_START(read_raw);
+	list_raw.read_stream(raw);
+	BENCH_END(read_raw, "read_stream", nintervals, sizeof(list_intervals::interval_type), 1, 1);
+
+	list_intervals list_compressed;
+	BENCH_START(read_compressed);
+	list_compressed.read_compressed_stream(compressed);
+	BENCH_END(read_compressed, "read_compressed_stream", nintervals, sizeof(list_intervals::interval_type), 1, 1);
+
+	if ((list_raw != list) || (list_compressed != list)) {
+		std::cerr << "Read lists are different from the original one!" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include <leeloo/interval.h>
+#include <leeloo/list_intervals.h>
+
+// Interval of type [a,b[
+typedef leeloo::list_intervals<leeloo::interval<uint32_t>, uint32_t> list_intervals;
+
+int main(int argc, char** argv)
+{
+	if (argc <= 3) {
+		std::cerr << "Usage: " << argv[0] << " n mean_size nlookups" << std::endl;
+		return 1;
+	}
+
+	list_intervals list;
+
+	const size_t n = atoll(argv[1]);
+	const size_t mean_size = atoll(argv[2]);
+	const size_t nlookups = atoll(argv[3]);
+
+	list.reserve(n);
+
+	srand(time(NULL));
+
+	std::cout << "Generate random intervals..." << std::endl;
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t a = rand();
+		const uint32_t b = a + (rand()%((rand()%(2*mean_size)) + 1));
+		list.add(a, b);
+	}
+	list.aggregate();
+	std::cout << "Done, " << list.intervals_count() << " intervals." << std::endl;
+
+	std::vector<uint32_t> values;
+	values.resize(nlookups);
+	for (size_t i = 0; i < nlookups; i++) {
+		values[i] = rand();
+	}
+
+	size_t found_ref = 0;
+	BENCH_START(contains);
+	for (uint32_t v: values) {
+		found_ref += list.contains(v);
+	}
+	BENCH_END(contains, "contains", nlookups, sizeof(uint32_t), 1, 1);
+
+	std::vector<uint8_t> res;
+	res.resize(nlookups);
+	BENCH_START(batch);
+	list.contains_batch(&values[0], nlookups, &res[0]);
+	BENCH_END(batch, "contains-batch", nlookups, sizeof(uint32_t), nlookups, 1);
+	size_t found_batch = std::count(res.begin(), res.end(), 1);
+
+	BENCH_START(index);
+	list.create_search_index();
+	BENCH_END(index, "create_search_index", list.intervals_count(), sizeof(list_intervals::interval_type), 1, 1);
+
+	size_t found = 0;
+	BENCH_START(contains_index);
+	for (uint32_t v: values) {
+		found += list.contains(v);
+	}
+	BENCH_END(contains_index, "contains-search-index", nlookups, sizeof(uint32_t), 1, 1);
+
+	BENCH_START(batch_index);
+	list.contains_batch(&values[0], nlookups, &res[0]);
+	BENCH_END(batch_index, "contains-batch-search-index", nlookups, sizeof(uint32_t), nlookups, 1);
+	size_t found_batch_index = std::count(res.begin(), res.end(), 1);
+
+	std::sort(values.begin(), values.end());
+	BENCH_START(batch_sorted);
+	list.contains_batch(&values[0], nlookups, &res[0]);
+	BENCH_END(batch_sorted, "contains-batch-sorted", nlookups, sizeof(uint32_t), nlookups, 1);
+	size_t found_batch_sorted = std::count(res.begin(), res.end(), 1);
+
+	if (found != found_ref) {
+		std::cerr << "Search index gives " << found << " matches, binary search " << found_ref << std::endl;
+		return 1;
+	}
+	if ((found_batch != found_ref) || (found_batch_index != found_ref) || (found_batch_sorted != found_ref)) {
+		std::cerr << "Batched contains gives " << found_batch << ", " << found_batch_index << " and " << found_batch_sorted << " matches, binary search " << found_ref << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
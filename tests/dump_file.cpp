@@ -71,7 +71,7 @@ int main()
 
 	list_intervals list;
 	list.read_from_fd(fd_tmp);
-	if (ref != list) {
+	if ((ref != list) || (ref.size() != list.size())) {
 		std::cerr << "Read after dump does not give the same result!" << std::endl;
 		return 1;
 	}
@@ -79,6 +79,183 @@ int main()
 	close(fd_tmp);
 	unlink(tmpfile);
 
+	{
+		// Container format, with and without index cache
+		char tmpfile_cont[] = "/tmp/leeloo-test-dump-XXXXXX";
+		close(mkstemp(tmpfile_cont));
+
+		list_intervals ref_cache(ref);
+		ref_cache.create_index_cache(1);
+		for (list_intervals const* l: {&ref, &ref_cache}) {
+			l->dump_container_to_file(tmpfile_cont);
+			list_intervals list_cont;
+			list_cont.read_container_from_file(tmpfile_cont);
+			if ((*l != list_cont) || (l->size() != list_cont.size()) || !list_cont.is_aggregated() ||
+			    (list_cont.index_cache_entry_size() != l->index_cache_entry_size()) ||
+			    (list_cont.index_cache_memory_size() != l->index_cache_memory_size())) {
+				std::cerr << "Read after dump with the container format does not give the same result!" << std::endl;
+				return 1;
+			}
+			if (list_cont.index_cache_entry_size() > 0) {
+				for (uint32_t i = 0; i < ref.size(); i++) {
+					if (list_cont.at_cached(i) != ref.at(i)) {
+						std::cerr << "Invalid index cache read from the container format!" << std::endl;
+						return 1;
+					}
+				}
+			}
+		}
+
+		// Corrupt the end of the index cache
+		int fd = open(tmpfile_cont, O_RDWR);
+		lseek(fd, -1, SEEK_END);
+		const char c = 0x7F;
+		if (write(fd, &c, 1) != 1) {
+			perror("write");
+			return 1;
+		}
+		close(fd);
+		bool invalid = false;
+		try {
+			list_intervals list_cont;
+			list_cont.read_container_from_file(tmpfile_cont);
+		}
+		catch (leeloo::file_format_exception const&) {
+			invalid = true;
+		}
+		if (!invalid) {
+			std::cerr << "Corrupted container hasn't been detected!" << std::endl;
+			return 1;
+		}
+
+		// Headers with sections out of the file, or overlapping the header
+		typedef leeloo::list_intervals_file_header header_type;
+		const uint64_t huge_count = 1ULL << 40;
+		const uint64_t null_offset = 0;
+		const std::pair<size_t, uint64_t> corruptions[] = {
+			{offsetof(header_type, intervals_count), huge_count},
+			{offsetof(header_type, intervals_offset), null_offset}
+		};
+		for (auto const& c: corruptions) {
+			ref.dump_container_to_file(tmpfile_cont);
+			fd = open(tmpfile_cont, O_RDWR);
+			if (pwrite(fd, &c.second, sizeof(uint64_t), c.first) != sizeof(uint64_t)) {
+				perror("pwrite");
+				return 1;
+			}
+			close(fd);
+			invalid = false;
+			try {
+				list_intervals list_cont;
+				list_cont.read_container_from_file(tmpfile_cont, false);
+			}
+			catch (leeloo::file_format_exception const&) {
+				invalid = true;
+			}
+			if (!invalid) {
+				std::cerr << "Invalid container header hasn't been detected!" << std::endl;
+				return 1;
+			}
+		}
+
+		// Invalid intervals and index cache, read without the checksum
+		for (size_t c = 0; c < 3; c++) {
+			list_intervals ref_cache1(ref);
+			ref_cache1.create_index_cache(1);
+			ref_cache1.dump_container_to_file(tmpfile_cont);
+			fd = open(tmpfile_cont, O_RDWR);
+			header_type header;
+			if (pread(fd, &header, sizeof(header), 0) != sizeof(header)) {
+				perror("pread");
+				return 1;
+			}
+			bool written;
+			if (c == 0) {
+				// Empty interval
+				const list_intervals::interval_type it(5, 5);
+				written = pwrite(fd, &it, sizeof(it), header.intervals_offset) == sizeof(it);
+			}
+			else
+			if (c == 1) {
+				// Unsorted intervals
+				const list_intervals::interval_type its[] = {list_intervals::interval_type(19, 21), list_intervals::interval_type(0, 15)};
+				written = pwrite(fd, its, sizeof(its), header.intervals_offset) == sizeof(its);
+			}
+			else {
+				// Wrong prefix sum
+				const list_intervals::size_type v = 1;
+				written = pwrite(fd, &v, sizeof(v), header.cache_offset) == sizeof(v);
+			}
+			close(fd);
+			if (!written) {
+				perror("pwrite");
+				return 1;
+			}
+			invalid = false;
+			try {
+				list_intervals list_cont;
+				list_cont.read_container_from_file(tmpfile_cont, false);
+			}
+			catch (leeloo::file_format_exception const&) {
+				invalid = true;
+			}
+			if (!invalid) {
+				std::cerr << "Invalid container content hasn't been detected!" << std::endl;
+				return 1;
+			}
+		}
+
+		// The index cache is out of date once intervals are added
+		{
+			list_intervals added(ref);
+			added.create_index_cache(1);
+			added.add(30, 40);
+			added.add(16, 17);
+			for (bool agg: {false, true}) {
+				if (agg) {
+					added.aggregate();
+				}
+				added.dump_container_to_file(tmpfile_cont);
+				list_intervals list_cont;
+				list_cont.read_container_from_file(tmpfile_cont);
+				if ((list_cont != added) || (list_cont.size() != added.size())) {
+					std::cerr << "Read after dump of a list with an out of date cache does not give the same result!" << std::endl;
+					return 1;
+				}
+				if (list_cont.index_cache_entry_size() != 0) {
+					std::cerr << "Out of date index cache written in the container format!" << std::endl;
+					return 1;
+				}
+			}
+			added.create_index_cache(1);
+			added.dump_container_to_file(tmpfile_cont);
+			list_intervals list_cont;
+			list_cont.read_container_from_file(tmpfile_cont);
+			for (uint32_t i = 0; i < added.size(); i++) {
+				if (list_cont.at_cached(i) != added.at(i)) {
+					std::cerr << "Invalid index cache read from the container format!" << std::endl;
+					return 1;
+				}
+			}
+		}
+
+		// Raw dumps aren't containers
+		ref.dump_to_file(tmpfile_cont);
+		invalid = false;
+		try {
+			list_intervals list_cont;
+			list_cont.read_container_from_file(tmpfile_cont);
+		}
+		catch (leeloo::file_format_exception const&) {
+			invalid = true;
+		}
+		if (!invalid) {
+			std::cerr << "Raw dump read as a container!" << std::endl;
+			return 1;
+		}
+		unlink(tmpfile_cont);
+	}
+
 	{
 		std::stringstream ss;
 		ref.dump_stream(ss);
@@ -87,10 +264,153 @@ int main()
 		ss.seekg(0, std::stringstream::beg);
 		list_ss.read_stream(ss);
 
-		if (ref != list_ss) {
+		if ((ref != list_ss) || (ref.size() != list_ss.size())) {
 			std::cerr << "Deserialize after serialize with std::stream didn't give the same result!" << std::endl;
 			return 1;
 		}
+
+		// The intervals start with bytes that look like digits
+		list_intervals digits;
+		digits.add(0x39393939, 0x39393940);
+		std::stringstream ss_digits;
+		digits.dump_stream(ss_digits);
+		list_ss.read_stream(ss_digits);
+		if (digits != list_ss) {
+			std::cerr << "Deserialize after serialize with std::stream didn't give the same result!" << std::endl;
+			return 1;
+		}
+
+		// Several frames, read as a whole and chunk by chunk
+		list_intervals big;
+		for (uint32_t i = 0; i < 3*list_intervals::stream_frame_size + 10; i++) {
+			big.add(2*i, 2*i+1);
+		}
+		std::stringstream ss_big;
+		big.dump_stream(ss_big);
+		const std::string data = ss_big.str();
+		std::stringstream ss_read(data);
+		list_ss.read_stream(ss_read);
+		if ((big != list_ss) || (big.size() != list_ss.size())) {
+			std::cerr << "Deserialize after serialize of several frames didn't give the same result!" << std::endl;
+			return 1;
+		}
+
+		std::stringstream ss_chunks(data);
+		size_t nchunks = 0;
+		uint32_t next = 0;
+		bool valid = true;
+		list_intervals::read_stream_chunks(ss_chunks,
+			[&](list_intervals::interval_type const* ints, size_t n)
+			{
+				nchunks++;
+				for (size_t i = 0; i < n; i++) {
+					valid = valid && (ints[i].lower() == 2*next) && (ints[i].upper() == 2*next+1);
+					next++;
+				}
+			});
+		if (!valid || (next != big.intervals_count()) || (nchunks != 4)) {
+			std::cerr << "Invalid chunks read from the stream!" << std::endl;
+			return 1;
+		}
+
+		std::stringstream ss_trunc(data.substr(0, data.size()-1));
+		bool invalid = false;
+		try {
+			list_ss.read_stream(ss_trunc);
+		}
+		catch (leeloo::file_format_exception const&) {
+			invalid = true;
+		}
+		if (!invalid || (list_ss.intervals_count() != 0)) {
+			std::cerr << "Truncated stream hasn't been detected!" << std::endl;
+			return 1;
+		}
+	}
+
+	{
+		// Compressed format, with empty, partial and full blocks
+		list_intervals big;
+		srand(0);
+		for (size_t i = 0; i < 1000; i++) {
+			const uint32_t a = rand();
+			big.add(a, a + 1 + (rand() % 1000));
+		}
+		list_intervals not_aggregated(big);
+		big.aggregate();
+		list_intervals full;
+		full.add(0, 0xFFFFFFFF);
+		list_intervals empty;
+
+		for (list_intervals const* l: {&ref, &big, &not_aggregated, &full, &empty}) {
+			std::stringstream ss;
+			l->dump_compressed_stream(ss);
+			list_intervals list_ss;
+			list_ss.read_compressed_stream(ss);
+			if ((*l != list_ss) || (l->size() != list_ss.size()) || (l->is_aggregated() != list_ss.is_aggregated())) {
+				std::cerr << "Read after dump with the compressed format does not give the same result!" << std::endl;
+				return 1;
+			}
+		}
+
+		std::stringstream ss;
+		big.dump_compressed_stream(ss);
+		std::string data = ss.str();
+		data.resize(data.size()-1);
+		std::stringstream ss_trunc(data);
+		bool invalid = false;
+		try {
+			list_intervals list_ss;
+			list_ss.read_compressed_stream(ss_trunc);
+		}
+		catch (leeloo::file_format_exception const&) {
+			invalid = true;
+		}
+		if (!invalid) {
+			std::cerr << "Truncated compressed stream hasn't been detected!" << std::endl;
+			return 1;
+		}
+
+		// A huge count in the header, and intervals that overflow
+		leeloo::list_intervals_compressed_header header;
+		memcpy(&header, ss.str().data(), sizeof(header));
+		header.intervals_count = 1ULL << 40;
+		std::string huge((const char*) &header, sizeof(header));
+		header.intervals_count = 1;
+		std::string overflow((const char*) &header, sizeof(header));
+		overflow += std::string(2, (char) 32);
+		overflow += std::string(2*leeloo::__impl::bit_packing_bytes(32), (char) 0xFF);
+		for (std::string const& s: {huge, overflow}) {
+			std::stringstream ss_invalid(s);
+			invalid = false;
+			try {
+				list_intervals list_ss;
+				list_ss.read_compressed_stream(ss_invalid);
+			}
+			catch (leeloo::file_format_exception const&) {
+				invalid = true;
+			}
+			if (!invalid) {
+				std::cerr << "Invalid compressed stream hasn't been detected!" << std::endl;
+				return 1;
+			}
+		}
+
+		// 64-bit intervals, whose values are split into two halves
+		typedef leeloo::list_intervals<leeloo::interval<uint64_t>, uint64_t> list_intervals64;
+		list_intervals64 big64;
+		for (size_t i = 0; i < 300; i++) {
+			const uint64_t a = (((uint64_t) rand()) << 32) | rand();
+			big64.add(a, a + 1 + (rand() % 1000));
+		}
+		big64.aggregate();
+		std::stringstream ss64;
+		big64.dump_compressed_stream(ss64);
+		list_intervals64 list64;
+		list64.read_compressed_stream(ss64);
+		if (big64 != list64) {
+			std::cerr << "Read after dump of 64-bit intervals with the compressed format does not give the same result!" << std::endl;
+			return 1;
+		}
 	}
 
 #ifdef LEELOO_BOOST_SERIALIZE
@@ -104,7 +424,7 @@ int main()
 		ss.seekg(0, std::stringstream::beg);
 		boost::archive::text_iarchive ia(ss);
 		ia >> list_boost;
-		if (ref != list_boost) {
+		if ((ref != list_boost) || (ref.size() != list_boost.size())) {
 			std::cerr << "Deserialize after serialize didn't give the same result!" << std::endl;
 			return 1;
 		}
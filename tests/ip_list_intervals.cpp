@@ -28,6 +28,8 @@
 
 #include <leeloo/ip_list_intervals.h>
 #include <iostream>
+#include <string>
+#include <vector>
 
 int compare_intervals(leeloo::ip_list_intervals const& l, uint32_t const* const ref, size_t const ninter)
 {
@@ -91,5 +93,52 @@ int main()
 
 	ret = compare_intervals(l, intervals_after, sizeof(intervals_after)/(2*sizeof(uint32_t)));
 
+	// Bulk loading, compared to add() and remove() range by range
+	{
+		srand(0);
+		std::string buf;
+		std::string buf_rem;
+		std::vector<size_t> ref_invalid;
+		leeloo::ip_list_intervals ref;
+		for (size_t i = 0; i < 100000; i++) {
+			std::string range;
+			if (i % 1000 == 0) {
+				range = "invalid";
+				ref_invalid.push_back(buf.size());
+			}
+			else {
+				const uint32_t ip = (((uint32_t) rand()) << 16) ^ rand();
+				range = std::to_string(ip >> 24) + "." + std::to_string((ip >> 16) & 0xFF) + "." + std::to_string((ip >> 8) & 0xFF) + ".0/" + std::to_string(20 + (i % 10));
+				ref.add(range.c_str());
+			}
+			buf += range + ";";
+			if (i % 3 == 0) {
+				ref.remove(range.c_str());
+				buf_rem += range + ";";
+			}
+		}
+		// The last range doesn't need a separator
+		buf += "1.2.3.4";
+		ref.add("1.2.3.4");
+
+		leeloo::ip_list_intervals bulk;
+		std::vector<size_t> invalid = bulk.add_many(buf.c_str(), buf.size(), ';');
+		std::vector<size_t> invalid_rem = bulk.remove_many(buf_rem.c_str(), buf_rem.size(), ';');
+		if ((invalid != ref_invalid) || (invalid_rem.size() != ref_invalid.size()/3 + 1)) {
+			std::cerr << "add_many/remove_many gave invalid offsets" << std::endl;
+			ret = 1;
+		}
+		if (bulk.size() != ref.size()) {
+			std::cerr << "add_many gave a different size" << std::endl;
+			ret = 1;
+		}
+		ref.aggregate();
+		bulk.aggregate();
+		if (ref != bulk) {
+			std::cerr << "add_many/remove_many gave different intervals than add/remove" << std::endl;
+			ret = 1;
+		}
+	}
+
 	return ret;
 }
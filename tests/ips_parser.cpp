@@ -31,8 +31,12 @@
 
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <vector>
 
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 void print_intervals(leeloo::ip_list_intervals const& l)
 {
@@ -132,6 +136,73 @@ int main()
 	TEST_IPV4I("10", 0, false);
 	TEST_IPV4I("google.com", 0, false);
 
+	std::cout << "Test ipv4toi at the end of a page..." << std::endl;
+	{
+		const size_t page = sysconf(_SC_PAGESIZE);
+		char* pages = (char*) mmap(nullptr, 2*page, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		mprotect(pages + page, page, PROT_NONE);
+		const char* str = "1.22.133.4";
+		const size_t len = strlen(str);
+		char* end = pages + page - len;
+		memcpy(end, str, len);
+		const uint32_t ip = leeloo::ips_parser::ipv4toi(end, len, valid);
+		if (!valid || (ip != 0x01168504)) {
+			std::cerr << "Invalid result for an IP at the end of a page" << std::endl;
+			return 1;
+		}
+		munmap(pages, 2*page);
+	}
+
+	std::cout << "Test ipv4toi_batch..." << std::endl;
+	{
+		srand(0);
+		std::string buf;
+		std::vector<uint32_t> ref_ips;
+		std::vector<uint8_t> ref_valid;
+		const char* invalid_lines[] = {"", "1.2.3", "1.2.3.256", "1..2.3", "1.2.3.4.5", "a.b.c.d", "1.2.3.1234", "   12.13.14.15   1", "1.2.3.4/"};
+		for (size_t i = 0; i < 10000; i++) {
+			if (i % 10 == 0) {
+				const char* line = invalid_lines[(i/10) % (sizeof(invalid_lines)/sizeof(const char*))];
+				buf += line;
+				ref_ips.push_back(0);
+				ref_valid.push_back(false);
+			}
+			else {
+				const uint32_t ip = (((uint32_t) rand()) << 16) ^ rand();
+				std::string line = std::to_string(ip >> 24) + "." + std::to_string((ip >> 16) & 0xFF) + "." + std::to_string((ip >> 8) & 0xFF) + "." + std::to_string(ip & 0xFF);
+				if (i % 7 == 0) {
+					line = "  " + line + " ";
+				}
+				buf += line;
+				ref_ips.push_back(ip);
+				ref_valid.push_back(true);
+			}
+			buf += "\n";
+		}
+		// The last line has no new line
+		buf += "8.8.4.4";
+		ref_ips.push_back(0x08080404);
+		ref_valid.push_back(true);
+
+		const size_t nlines = ref_ips.size();
+		std::vector<uint32_t> ips(nlines);
+		std::vector<uint8_t> valids(nlines);
+		size_t consumed = 0;
+		// Two calls, to check that parsing can be resumed
+		size_t n = leeloo::ips_parser::ipv4toi_batch(buf.c_str(), buf.size(), &ips[0], &valids[0], nlines/2, &consumed);
+		n += leeloo::ips_parser::ipv4toi_batch(buf.c_str() + consumed, buf.size() - consumed, &ips[n], &valids[n], nlines, &consumed);
+		if (n != nlines) {
+			std::cerr << "ipv4toi_batch parsed " << n << " lines instead of " << nlines << std::endl;
+			return 1;
+		}
+		for (size_t i = 0; i < nlines; i++) {
+			if ((valids[i] != ref_valid[i]) || (ref_valid[i] && (ips[i] != ref_ips[i]))) {
+				std::cerr << "ipv4toi_batch gives an invalid result for line " << i << std::endl;
+				return 1;
+			}
+		}
+	}
+
 	std::cout << "Test ips parser..." << std::endl;
 	TEST_IP_PARSER("10.0.0.0-10.0.0.255", true, "10.0.0.0", "10.0.0.255");
 	TEST_IP_PARSER("   10.0.0.0-10.0.0.255", true, "10.0.0.0", "10.0.0.255");
@@ -187,5 +258,42 @@ int main()
 		ret |= test_dashes("10.4.5.8-20", ref);
 	}
 
+	// Full trailing bytes give a single interval for each combination of the
+	// leading ones
+	{
+		leeloo::ip_list_intervals ref;
+		ref.add(leeloo::ips_parser::ipv4toi("10.4.8.0", valid), leeloo::ips_parser::ipv4toi("10.4.11.255", valid));
+		ref.add(leeloo::ips_parser::ipv4toi("10.5.8.0", valid), leeloo::ips_parser::ipv4toi("10.5.11.255", valid));
+		ret |= test_dashes("10.4-5.8-11.0-255", ref);
+	}
+	{
+		leeloo::ip_list_intervals ref;
+		ref.add(leeloo::ips_parser::ipv4toi("1.0.0.0", valid), leeloo::ips_parser::ipv4toi("200.255.255.255", valid));
+		ret |= test_dashes("1-200.0-255.0-255.0-255", ref);
+	}
+	{
+		leeloo::ip_list_intervals ref;
+		ref.add(leeloo::ips_parser::ipv4toi("0.0.0.0", valid), leeloo::ips_parser::ipv4toi("255.255.255.255", valid));
+		ret |= test_dashes("0-255.0-255.0-255.0-255", ref);
+	}
+	{
+		leeloo::ip_list_intervals ref;
+		ref.add(leeloo::ips_parser::ipv4toi("1.3.4.5", valid), leeloo::ips_parser::ipv4toi("1.3.4.5", valid));
+		ref.add(leeloo::ips_parser::ipv4toi("2.3.4.5", valid), leeloo::ips_parser::ipv4toi("2.3.4.5", valid));
+		ret |= test_dashes("1-2.3.4.5", ref);
+	}
+	{
+		leeloo::ip_list_intervals ref;
+		ref.add(leeloo::ips_parser::ipv4toi("10.4.8.0", valid), leeloo::ips_parser::ipv4toi("10.4.8.0", valid));
+		ref.add(leeloo::ips_parser::ipv4toi("10.5.8.0", valid), leeloo::ips_parser::ipv4toi("10.5.8.0", valid));
+		ret |= test_dashes("10.4-5.8.0", ref);
+	}
+	TEST_IP_PARSER("10.4-5.0-255.0-255", true, "10.4.0.0", "10.5.255.255");
+	TEST_IP_PARSER("1-2.3.4.256-300", false, "", "");
+	TEST_IP_PARSER("1-2.3.4", false, "", "");
+	TEST_IP_PARSER("1-2.3.4.5.6", false, "", "");
+	TEST_IP_PARSER("1-2.3.4.5/24", false, "", "");
+	TEST_IP_PARSER("10.0.0.0/33", false, "", "");
+
 	return ret;
 }
@@ -0,0 +1,158 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <leeloo/ip_list_intervals.h>
+#include <leeloo/ips_writer.h>
+
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static std::string read_all(int fd)
+{
+	std::string ret;
+	lseek(fd, 0, SEEK_SET);
+	char buf[4096];
+	ssize_t r;
+	while ((r = read(fd, buf, sizeof(buf))) > 0) {
+		ret.append(buf, r);
+	}
+	return ret;
+}
+
+static std::string write_to_string(leeloo::ip_list_intervals const& l, bool cidr)
+{
+	char tmpfile[] = "/tmp/leeloo-test-ips-writer-XXXXXX";
+	int fd = mkstemp(tmpfile);
+	unlink(tmpfile);
+	if (cidr) {
+		leeloo::ips_writer::write_cidr(fd, l);
+	}
+	else {
+		leeloo::ips_writer::write_ranges(fd, l);
+	}
+	std::string ret = read_all(fd);
+	close(fd);
+	return ret;
+}
+
+static std::string write_legacy_to_string(leeloo::ip_list_intervals const& l)
+{
+	char tmpfile[] = "/tmp/leeloo-test-ips-writer-XXXXXX";
+	int fd = mkstemp(tmpfile);
+	unlink(tmpfile);
+	leeloo::ips_writer::write_legacy(fd, l);
+	std::string ret = read_all(fd);
+	close(fd);
+	return ret;
+}
+
+int main()
+{
+	int ret = 0;
+
+	leeloo::ip_list_intervals l;
+	l.add("10.0.0.1-10.0.0.6");
+	l.add("192.168.0.0/24");
+	l.add("172.16.0.1");
+	l.add("0.0.0.0/1");
+	l.aggregate();
+
+	const std::string cidr = write_to_string(l, true);
+	const std::string cidr_ref = "0.0.0.0/1\n"
+		"172.16.0.1/32\n"
+		"192.168.0.0/24\n";
+	const std::string ranges = write_to_string(l, false);
+	const std::string ranges_ref = "0.0.0.0-127.255.255.255\n"
+		"172.16.0.1\n"
+		"192.168.0.0-192.168.0.255\n";
+	if (cidr != cidr_ref) {
+		std::cerr << "Invalid CIDR output:\n" << cidr << std::endl;
+		ret = 1;
+	}
+	if (ranges != ranges_ref) {
+		std::cerr << "Invalid ranges output:\n" << ranges << std::endl;
+		ret = 1;
+	}
+
+	const std::string legacy = write_legacy_to_string(l);
+	const std::string legacy_ref = "0.0.0.0/1\n"
+		"172.16.0.1/32\n"
+		"192.168.0.0/24\n";
+	if (legacy != legacy_ref) {
+		std::cerr << "Invalid legacy output:\n" << legacy << std::endl;
+		ret = 1;
+	}
+
+	leeloo::ip_list_intervals l2;
+	l2.add("10.0.0.1-10.0.0.6");
+	const std::string cidr2 = write_to_string(l2, true);
+	if (cidr2 != "10.0.0.1/32\n10.0.0.2/31\n10.0.0.4/31\n10.0.0.6/32\n") {
+		std::cerr << "Invalid CIDR decomposition:\n" << cidr2 << std::endl;
+		ret = 1;
+	}
+	const std::string legacy2 = write_legacy_to_string(l2);
+	if (legacy2 != "10.0.0.1-10.0.0.7\n") {
+		std::cerr << "Invalid legacy output:\n" << legacy2 << std::endl;
+		ret = 1;
+	}
+	leeloo::ip_list_intervals l3;
+	l3.add("10.0.0.2-10.0.0.5");
+	const std::string legacy3 = write_legacy_to_string(l3);
+	if (legacy3 != "10.0.0.2/30\n") {
+		std::cerr << "Invalid legacy output:\n" << legacy3 << std::endl;
+		ret = 1;
+	}
+
+	// Both outputs can be parsed back
+	srand(0);
+	leeloo::ip_list_intervals rnd;
+	for (size_t i = 0; i < 10000; i++) {
+		const uint32_t a = (((uint32_t) rand()) << 16) ^ rand();
+		rnd.add(a, a + (rand() % 100000));
+	}
+	rnd.add(0xFFFFFF00, 0xFFFFFFFF);
+	rnd.aggregate();
+	for (bool c: {true, false}) {
+		const std::string out = write_to_string(rnd, c);
+		leeloo::ip_list_intervals parsed;
+		if (!parsed.add_many(out.c_str(), out.size()).empty()) {
+			std::cerr << "Output can't be parsed back" << std::endl;
+			ret = 1;
+		}
+		parsed.aggregate();
+		if (parsed != rnd) {
+			std::cerr << "Output parsed back gives a different list" << std::endl;
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
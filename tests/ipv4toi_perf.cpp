@@ -0,0 +1,83 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <leeloo/bench.h>
+#include <leeloo/ips_parser.h>
+
+int main(int argc, char** argv)
+{
+	if (argc <= 1) {
+		std::cerr << "Usage: " << argv[0] << " nips" << std::endl;
+		return 1;
+	}
+
+	const size_t n = atoll(argv[1]);
+
+	srand(time(NULL));
+
+	std::string buf;
+	buf.reserve(n*16);
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t ip = (((uint32_t) rand()) << 16) ^ rand();
+		buf += std::to_string(ip >> 24) + "." + std::to_string((ip >> 16) & 0xFF) + "." + std::to_string((ip >> 8) & 0xFF) + "." + std::to_string(ip & 0xFF) + "\n";
+	}
+
+	std::vector<uint32_t> ips(n);
+	std::vector<uint8_t> valid(n);
+
+	BENCH_START(ipv4toi);
+	const char* cur = buf.c_str();
+	for (size_t i = 0; i < n; i++) {
+		const char* nl = (const char*) memchr(cur, '\n', buf.size() - (cur - buf.c_str()));
+		bool v;
+		ips[i] = leeloo::ips_parser::ipv4toi(cur, nl - cur, v);
+		valid[i] = v;
+		cur = nl + 1;
+	}
+	BENCH_END(ipv4toi, "ipv4toi", buf.size(), 1, n, sizeof(uint32_t));
+
+	std::vector<uint32_t> ips_batch(n);
+	BENCH_START(batch);
+	const size_t nparsed = leeloo::ips_parser::ipv4toi_batch(buf.c_str(), buf.size(), &ips_batch[0], &valid[0], n);
+	BENCH_END(batch, "ipv4toi_batch", buf.size(), 1, n, sizeof(uint32_t));
+
+	if ((nparsed != n) || (ips != ips_batch)) {
+		std::cerr << "ipv4toi and ipv4toi_batch give different results!" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -26,11 +26,13 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <set>
+#include <vector>
 
 #include <boost/random.hpp>
 
@@ -119,6 +121,29 @@ int main(int argc, char** argv)
 		ret = compare_intervals(list, intervals_agg, sizeof(intervals_agg)/(2*sizeof(uint32_t)));
 	}
 
+	{
+		// Cached statistics
+		list_intervals lstats;
+		lstats.add(0, 10);
+		lstats.add(5, 12);
+		lstats.add(20, 21);
+		if ((lstats.size() != 18) || (lstats.min_interval_width() != 1) || (lstats.max_interval_width() != 10)) {
+			std::cerr << "Error: invalid statistics before aggregation" << std::endl;
+			return 1;
+		}
+		lstats.remove(0, 2);
+		lstats.aggregate();
+		if ((lstats.size() != 11) || (lstats.min_interval_width() != 1) || (lstats.max_interval_width() != 10)) {
+			std::cerr << "Error: invalid statistics after aggregation" << std::endl;
+			return 1;
+		}
+		lstats.clear();
+		if ((lstats.size() != 0) || (lstats.min_interval_width() != 0) || (lstats.max_interval_width() != 0)) {
+			std::cerr << "Error: invalid statistics after clear" << std::endl;
+			return 1;
+		}
+	}
+
 	const size_t n = argc >= 2 ? atoll(argv[1]) : 127;
 
 	list.clear();
@@ -150,9 +175,174 @@ int main(int argc, char** argv)
 		}
 	}
 
+	{
+		// Same results with the search index
+		list_intervals lidx(list);
+		lidx.create_search_index();
+		for (size_t i = 0; i < intervals.size(); i++) {
+			const uint32_t v = intervals[i].lower();
+			for (uint32_t vtest = (v > 0) ? v-1 : v; vtest <= intervals[i].upper(); vtest++) {
+				if (lidx.contains(vtest) != list.contains(vtest)) {
+					std::cerr << "Error: contains with search index returns invalid results for " << vtest << "!" << std::endl;
+					ret = 1;
+				}
+			}
+		}
+		if (lidx.contains(0) || lidx.contains(0xFFFFFFFF)) {
+			std::cerr << "Error: contains with search index returns invalid results for bounds!" << std::endl;
+			ret = 1;
+		}
+	}
+
+	{
+		// Batched contains, with random and sorted values
+		std::vector<uint32_t> values;
+		for (size_t i = 0; i < intervals.size(); i++) {
+			values.push_back(intervals[i].lower());
+			values.push_back(intervals[i].upper());
+			values.push_back(intervals[i].lower()-1);
+			values.push_back(rand());
+		}
+		values.push_back(0);
+		values.push_back(0xFFFFFFFF);
+		std::random_shuffle(values.begin(), values.end());
+
+		list_intervals lidx(list);
+		lidx.create_search_index();
+		std::vector<uint8_t> res(values.size());
+		leeloo::bit_field res_bits;
+		for (int sorted = 0; sorted < 2; sorted++) {
+			if (sorted) {
+				std::sort(values.begin(), values.end());
+			}
+			for (list_intervals const* l: {&list, &lidx}) {
+				l->contains_batch(&values[0], values.size(), &res[0]);
+				l->contains_batch(&values[0], values.size(), res_bits);
+				for (size_t i = 0; i < values.size(); i++) {
+					const bool ref = list.contains(values[i]);
+					if ((res[i] != ref) || (res_bits.get_bit_fast(i) != ref)) {
+						std::cerr << "Error: contains_batch returns invalid results for " << values[i] << "!" << std::endl;
+						return 1;
+					}
+				}
+			}
+		}
+	}
+
+	{
+		// Divide into parts with the same number of values, with and
+		// without the rank index
+		list_intervals lrank(list);
+		lrank.create_rank_index();
+		for (list_intervals const* l: {&list, &lrank}) {
+			for (uint32_t nparts: {1U, 2U, 3U, 7U, 64U}) {
+				std::vector<list_intervals> parts = l->divide_by(nparts);
+				std::vector<list_intervals::view_type> views = l->divide_by_views(nparts);
+				if ((parts.size() != nparts) || (views.size() != nparts)) {
+					std::cerr << "Error: divide_by returns " << parts.size() << " parts instead of " << nparts << std::endl;
+					return 1;
+				}
+				list_intervals all;
+				uint32_t rank = 0;
+				for (size_t i = 0; i < nparts; i++) {
+					const uint32_t psize = parts[i].size();
+					if ((psize != list.size()/nparts + (i < list.size()%nparts ? 1 : 0)) ||
+					    (views[i].size() != psize) || (views[i].intervals_count() != parts[i].intervals_count())) {
+						std::cerr << "Error: divide_by gives a part of invalid size " << psize << std::endl;
+						return 1;
+					}
+					for (uint32_t r = 0; r < psize; r += 97) {
+						if ((parts[i].at(r) != list.at(rank+r)) || (views[i].at(r) != list.at(rank+r)) ||
+						    !views[i].contains(list.at(rank+r))) {
+							std::cerr << "Error: divide_by gives an invalid value at rank " << rank+r << std::endl;
+							return 1;
+						}
+					}
+					if ((psize > 0) && (views[i].contains(list.at(rank)-1) || ((rank+psize < list.size()) && views[i].contains(list.at(rank+psize))))) {
+						std::cerr << "Error: divide_by view contains values outside of its part" << std::endl;
+						return 1;
+					}
+					rank += psize;
+					all.add(parts[i]);
+				}
+				all.aggregate();
+				if (all != list) {
+					std::cerr << "Error: the union of the parts of divide_by isn't the original list" << std::endl;
+					return 1;
+				}
+			}
+		}
+		// Clipped view, checked at each rank against its values
+		if (intervals.size() > 40) {
+			const size_t first = 3;
+			const size_t last = intervals.size() - 5;
+			list_intervals::view_type view(list, first, last, intervals[first].upper()-1, intervals[last-1].lower()+1);
+			uint32_t r = 0;
+			for (list_intervals::interval_type const& it: view) {
+				for (uint32_t v = it.lower(); v != it.upper(); v++) {
+					if (view.at(r) != v) {
+						std::cerr << "Error: invalid value at rank " << r << " of a view" << std::endl;
+						return 1;
+					}
+					r++;
+				}
+			}
+			if (r != view.size()) {
+				std::cerr << "Error: invalid view size" << std::endl;
+				return 1;
+			}
+		}
+
+		list_intervals lsmall;
+		lsmall.add(0, 3);
+		lsmall.aggregate();
+		std::vector<list_intervals> parts = lsmall.divide_by(5);
+		if ((parts.size() != 5) || (parts[0].size() != 1) || (parts[2].size() != 1) || (parts[3].size() != 0) || (parts[4].intervals_count() != 0)) {
+			std::cerr << "Error: divide_by with more parts than values" << std::endl;
+			return 1;
+		}
+	}
+
+	{
+		// Enough intervals so that aggregation is done by several tasks
+		const size_t nbig = 5*list_intervals::merge_chunk_size;
+		list_intervals lbig;
+		std::vector<std::pair<uint32_t, uint32_t>> ref_ints;
+		lbig.reserve(nbig);
+		ref_ints.reserve(nbig);
+		for (size_t i = 0; i < nbig; i++) {
+			const uint32_t a = rand()%(nbig*64);
+			const uint32_t b = a + (rand()%256) + 1;
+			lbig.add(a, b);
+			ref_ints.emplace_back(a, b);
+		}
+		lbig.aggregate();
+
+		std::sort(ref_ints.begin(), ref_ints.end());
+		std::vector<uint32_t> ref_agg;
+		ref_agg.push_back(ref_ints[0].first);
+		ref_agg.push_back(ref_ints[0].second);
+		for (size_t i = 1; i < nbig; i++) {
+			if (ref_ints[i].first <= ref_agg.back()) {
+				ref_agg.back() = std::max(ref_agg.back(), ref_ints[i].second);
+			}
+			else {
+				ref_agg.push_back(ref_ints[i].first);
+				ref_agg.push_back(ref_ints[i].second);
+			}
+		}
+		if (compare_intervals(lbig, &ref_agg[0], ref_agg.size()/2) != 0) {
+			std::cerr << "Error: parallel aggregation gives invalid results!" << std::endl;
+			return 1;
+		}
+	}
+
 	// Checked cached item access
 	list.create_index_cache(16);
 
+	list_intervals lrank(list);
+	lrank.create_rank_index();
+
 	const uint32_t size_all = list.size();
 	std::cout << "Size all: " << size_all << std::endl;
 	for (uint32_t i = 0; i < size_all; i++) {
@@ -162,6 +352,59 @@ int main(int argc, char** argv)
 			std::cerr << "Error in at_cached: i=" << i << ", got " << v1 << ", should be " << v0 << std::endl;
 			ret = 1;
 		}
+		const uint32_t v2 = lrank.at(i);
+		if (v0 != v2) {
+			std::cerr << "Error in at with rank index: i=" << i << ", got " << v2 << ", should be " << v0 << std::endl;
+			return 1;
+		}
+	}
+
+	{
+		// Automatic choice of the cache entry size
+		list_intervals lauto(list);
+		for (leeloo::index_cache_tuning tuning: {leeloo::index_cache_tuning::l2_size, leeloo::index_cache_tuning::probe}) {
+			const size_t entry_size = lauto.create_index_cache(tuning);
+			if ((entry_size == 0) || (entry_size != lauto.index_cache_entry_size()) ||
+			    (lauto.index_cache_memory_size() != ((lauto.intervals_count()+entry_size-1)/entry_size)*sizeof(list_intervals::size_type))) {
+				std::cerr << "Error: invalid automatic index cache (entry size " << entry_size << ")" << std::endl;
+				return 1;
+			}
+			for (uint32_t i = 0; i < size_all; i += 7) {
+				if (lauto.at_cached(i) != lrank.at(i)) {
+					std::cerr << "Error in at_cached with an automatic index cache: i=" << i << std::endl;
+					return 1;
+				}
+			}
+		}
+	}
+
+	{
+		// Batched lookups, with random, sorted and nearly sorted ranks
+		std::vector<uint32_t> ranks;
+		for (uint32_t i = 0; i < 1000; i++) {
+			ranks.push_back(rand()%size_all);
+		}
+		ranks.push_back(0);
+		ranks.push_back(size_all-1);
+		std::vector<uint32_t> res(ranks.size());
+		for (int order = 0; order < 3; order++) {
+			if (order == 1) {
+				std::sort(ranks.begin(), ranks.end());
+			}
+			else
+			if (order == 2) {
+				std::swap(ranks[10], ranks[500]);
+			}
+			for (list_intervals const* l: {&list, &lrank}) {
+				l->at_cached_batch(&ranks[0], &res[0], ranks.size());
+				for (size_t i = 0; i < ranks.size(); i++) {
+					if (res[i] != lrank.at(ranks[i])) {
+						std::cerr << "Error in at_cached_batch: rank " << ranks[i] << ", got " << res[i] << ", should be " << lrank.at(ranks[i]) << std::endl;
+						return 1;
+					}
+				}
+			}
+		}
 	}
 
 	{
@@ -313,6 +556,29 @@ int main(int argc, char** argv)
 		COMPARE()
 	}
 
+	std::cout << "([0,100[,[200,210[,[300,310[,[400,410[) - ([10,11[,[20,21[,[30,31[,[200,210[,[300,310[,[400,410[)" << std::endl;
+	list.clear();
+	list.add(0, 100);
+	list.add(200, 210);
+	list.add(300, 310);
+	list.add(400, 410);
+	list.remove(10, 11);
+	list.remove(20, 21);
+	list.remove(30, 31);
+	list.remove(200, 210);
+	list.remove(300, 310);
+	list.remove(400, 410);
+	list.aggregate();
+	{
+		uint32_t intervals_agg[] = {
+			0, 10,
+			11, 20,
+			21, 30,
+			31, 100
+		};
+		COMPARE()
+	}
+
 	list.clear();
 	for (size_t i = 0; i < 20; i++) {
 		list.add(i*10, ((i+1)*10) - 1);
@@ -346,6 +612,58 @@ int main(int argc, char** argv)
 		COMPARE()
 	}
 
+	std::cout << "Incremental: ([0,10[,[20,30[,[40,50[) + ([5,22[,[60,70[) - ([45,46[)" << std::endl;
+	list.clear();
+	list.add(0, 10);
+	list.add(20, 30);
+	list.add(40, 50);
+	list.aggregate();
+	if (!list.is_aggregated()) {
+		std::cerr << "list should be aggregated" << std::endl;
+		ret = 1;
+	}
+	list.add(60, 70);
+	list.add(5, 22);
+	list.remove(45, 46);
+	if (list.is_aggregated()) {
+		std::cerr << "list shouldn't be aggregated" << std::endl;
+		ret = 1;
+	}
+	list.aggregate();
+	{
+		uint32_t intervals_agg[] = {
+			0, 30,
+			40, 45,
+			46, 50,
+			60, 70
+		};
+		COMPARE()
+	}
+
+	// Incremental aggregations must give the same list as a full one
+	{
+		srand(time(NULL));
+		list_intervals inc;
+		list_intervals full;
+		for (size_t round = 0; round < 20; round++) {
+			const size_t n = (round == 0) ? 2000 : (rand() % 200);
+			for (size_t i = 0; i < n; i++) {
+				const uint32_t a = rand() % 1000000;
+				const uint32_t b = a + 1 + (rand() % 1000);
+				inc.add(a, b);
+				full.add(a, b);
+			}
+			inc.aggregate();
+			list_intervals ref_full(full);
+			ref_full.aggregate();
+			if ((inc != ref_full) || (inc.intervals_count() != ref_full.intervals_count()) || (inc.size() != ref_full.size())) {
+				std::cerr << "Incremental aggregation differs from a full one at round " << round << std::endl;
+				ret = 1;
+				break;
+			}
+		}
+	}
+
 	list.clear();
 	list.add(10, 50);
 	list.add(1000, 1100);
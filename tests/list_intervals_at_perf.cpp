@@ -30,7 +30,9 @@
 #include <cstdint>
 #include <cstdlib>
 #include <ctime>
+#include <algorithm>
 #include <set>
+#include <vector>
 
 #include <boost/random.hpp>
 
@@ -49,51 +51,114 @@ void print_intervals(Interval const& l)
 // Interval of type [a,b[
 typedef leeloo::list_intervals<leeloo::interval<uint32_t>, uint32_t> list_intervals;
 
-int main(int argc, char** argv)
+static int bench_lookups(size_t const n, size_t const mean_size, size_t const nlookups)
 {
-	if (argc <= 2) {
-		std::cerr << "Usage: " << argv[0] << " n mean_size" << std::endl;
-		return 1;
-	}
-
 	list_intervals list;
-
-	const size_t n = atoll(argv[1]);
-	const size_t mean_size = atoll(argv[2]);
-
-	list.clear();
 	list.reserve(n);
 
-	srand(time(NULL));
-
-	std::cout << "Generate random intervals..." << std::endl;
-	// Generate random intervals
 	for (size_t i = 0; i < n; i++) {
 		const uint32_t a = rand();
-		const uint32_t b = a + (rand()%((rand()%(2*mean_size)) + 1));
+		const uint32_t b = a + 1 + (rand()%(2*mean_size));
 		list.add(a, b);
 	}
-	std::cout << "Done." << std::endl;
-
 	list.aggregate();
 
-	// Checked cached item access
+	const uint32_t size_all = list.size();
+	std::cout << "== " << list.intervals_count() << " intervals, mean size " << mean_size << ", " << size_all << " values" << std::endl;
+
+	std::vector<uint32_t> ranks;
+	ranks.resize(nlookups);
+	for (size_t i = 0; i < nlookups; i++) {
+		ranks[i] = rand()%size_all;
+	}
+
+	std::vector<uint32_t> res_cached;
+	res_cached.resize(nlookups);
 	BENCH_START(cache);
 	list.create_index_cache(16);
-	BENCH_END(cache, "create_index_cache", 1, 1, 1, 1);
+	BENCH_END(cache, "create_index_cache", list.intervals_count(), sizeof(list_intervals::interval_type), 1, 1);
 
-	const uint32_t size_all = list.size();
-	std::cout << "Performances of getting the last element:" << std::endl;
+	BENCH_START(at_cached);
+	for (size_t i = 0; i < nlookups; i++) {
+		res_cached[i] = list.at_cached(ranks[i]);
+	}
+	BENCH_END(at_cached, "at-cached", nlookups, sizeof(uint32_t), nlookups, sizeof(uint32_t));
 
-	list.at(size_all-1);
+	std::vector<uint32_t> res_batch;
+	res_batch.resize(nlookups);
+	BENCH_START(at_cached_batch);
+	for (size_t i = 0; i < nlookups; i += 4096) {
+		list.at_cached_batch(&ranks[i], &res_batch[i], std::min((size_t)4096, nlookups-i));
+	}
+	BENCH_END(at_cached_batch, "at-cached-batch", nlookups, sizeof(uint32_t), nlookups, sizeof(uint32_t));
+	if (res_batch != res_cached) {
+		std::cerr << "at_cached_batch() and at_cached() differ" << std::endl;
+		return 1;
+	}
+
+	// The linear version is only run on a few lookups
+	const size_t nlookups_linear = std::max((size_t)1, std::min(nlookups, (size_t)(1<<24)/list.intervals_count()));
 	BENCH_START(at);
-	list.at(size_all-1);
-	BENCH_END(at, "at", sizeof(list_intervals::interval_type), n, 1, sizeof(uint32_t));
+	for (size_t i = 0; i < nlookups_linear; i++) {
+		if (list.at(ranks[i]) != res_cached[i]) {
+			std::cerr << "at() and at_cached() differ for rank " << ranks[i] << std::endl;
+			return 1;
+		}
+	}
+	BENCH_END(at, "at", nlookups_linear, sizeof(uint32_t), nlookups_linear, sizeof(uint32_t));
 
-	list.at_cached(size_all-1);
-	BENCH_START(at_cached);
-	list.at_cached(size_all-1);
-	BENCH_END(at_cached, "at-cached", sizeof(list_intervals::interval_type), n, 1, sizeof(uint32_t));
+	BENCH_START(rank);
+	list.create_rank_index();
+	BENCH_END(rank, "create_rank_index", list.intervals_count(), sizeof(list_intervals::interval_type), 1, 1);
+
+	std::vector<uint32_t> res;
+	res.resize(nlookups);
+	BENCH_START(at_rank);
+	for (size_t i = 0; i < nlookups; i++) {
+		res[i] = list.at(ranks[i]);
+	}
+	BENCH_END(at_rank, "at-rank-index", nlookups, sizeof(uint32_t), nlookups, sizeof(uint32_t));
+
+	BENCH_START(at_rank_batch);
+	for (size_t i = 0; i < nlookups; i += 4096) {
+		list.at_cached_batch(&ranks[i], &res_batch[i], std::min((size_t)4096, nlookups-i));
+	}
+	BENCH_END(at_rank_batch, "at-cached-batch-rank-index", nlookups, sizeof(uint32_t), nlookups, sizeof(uint32_t));
+	if (res_batch != res_cached) {
+		std::cerr << "at_cached_batch() with the rank index and at_cached() differ" << std::endl;
+		return 1;
+	}
+
+	if (res != res_cached) {
+		std::cerr << "at() with the rank index and at_cached() differ" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	srand(time(NULL));
+
+	if (argc > 1 && argc <= 3) {
+		std::cerr << "Usage: " << argv[0] << " [n mean_size nlookups]" << std::endl;
+		return 1;
+	}
+
+	if (argc > 3) {
+		return bench_lookups(atoll(argv[1]), atoll(argv[2]), atoll(argv[3]));
+	}
+
+	// Sweep interval counts and widths
+	const size_t nlookups = 1<<20;
+	for (size_t n: {1<<10, 1<<14, 1<<18, 1<<22}) {
+		for (size_t mean_size: {1, 16, 256}) {
+			if (bench_lookups(n, mean_size, nlookups) != 0) {
+				return 1;
+			}
+		}
+	}
 
 	return 0;
 }
@@ -0,0 +1,204 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <set>
+#include <vector>
+#include <algorithm>
+
+#include <boost/random.hpp>
+
+#include <leeloo/interval.h>
+#include <leeloo/list_intervals.h>
+#include <leeloo/list_intervals_mmap.h>
+#include <leeloo/random.h>
+
+// Interval of type [a,b[
+typedef leeloo::list_intervals<leeloo::interval<uint32_t>, uint32_t> list_intervals;
+typedef leeloo::list_intervals_mmap<list_intervals> list_intervals_mmap;
+
+int main()
+{
+	char tmpfile[] = "/tmp/leeloo-test-mmap-XXXXXX";
+	int fd_tmp = mkstemp(tmpfile);
+
+	list_intervals ref;
+	srand(0);
+	for (size_t i = 0; i < 1000; i++) {
+		const uint32_t a = rand();
+		ref.add(a, a + (rand()%100) + 1);
+	}
+	ref.aggregate();
+	ref.dump_to_fd(fd_tmp);
+	close(fd_tmp);
+
+	list_intervals_mmap lm;
+	lm.map_file(tmpfile);
+	unlink(tmpfile);
+
+	if (!lm.validate() || (lm.intervals_count() != ref.intervals_count()) || (lm.size() != ref.size())) {
+		std::cerr << "Mapped list isn't the same as the dumped one!" << std::endl;
+		return 1;
+	}
+
+	list_intervals::container_type const& ref_ints = const_cast<list_intervals const&>(ref).intervals();
+	size_t i = 0;
+	for (list_intervals::interval_type const& it: lm) {
+		if ((it.lower() != ref_ints[i].lower()) || (it.upper() != ref_ints[i].upper())) {
+			std::cerr << "Invalid interval at index " << i << std::endl;
+			return 1;
+		}
+		if (!lm.contains(it.lower()) || !lm.contains(it.upper()-1) || lm.contains(it.upper())) {
+			std::cerr << "contains returns invalid results for interval " << i << std::endl;
+			return 1;
+		}
+		i++;
+	}
+
+	// Each value must be given exactly once, with or without an index cache
+	boost::random::mt19937 mt_rand(time(NULL));
+	auto check_random_sets = [&]()
+	{
+		std::set<uint32_t> values;
+		size_t nvalues = 0;
+		lm.random_sets(16,
+			[&](uint32_t const* ints, const size_t size)
+			{
+				for (size_t j = 0; j < size; j++) {
+					values.insert(ints[j]);
+				}
+				nvalues += size;
+			},
+			leeloo::random_engine<uint32_t>(mt_rand));
+		return (nvalues == ref.size()) && (values.size() == ref.size()) && ref.contains(*values.begin()) && ref.contains(*values.rbegin());
+	};
+	if (!check_random_sets() || lm.has_index_cache()) {
+		std::cerr << "random_sets returns invalid results without an index cache" << std::endl;
+		return 1;
+	}
+
+	lm.create_index_cache();
+	for (uint32_t r = 0; r < ref.size(); r += 13) {
+		if ((lm.at(r) != ref.at(r)) || (lm.at_cached(r) != ref.at(r))) {
+			std::cerr << "Invalid value at rank " << r << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<uint32_t> ranks;
+	for (uint32_t r = 0; r < ref.size(); r += 5) {
+		ranks.push_back(r);
+	}
+	// Sorted, then shuffled ranks
+	for (int pass = 0; pass < 2; pass++) {
+		std::vector<uint32_t> out(ranks.size());
+		lm.at_cached_batch(&ranks[0], &out[0], ranks.size());
+		for (size_t j = 0; j < ranks.size(); j++) {
+			if (out[j] != ref.at(ranks[j])) {
+				std::cerr << "Invalid value at rank " << ranks[j] << " with at_cached_batch" << std::endl;
+				return 1;
+			}
+		}
+		std::random_shuffle(ranks.begin(), ranks.end());
+	}
+
+	if (!check_random_sets()) {
+		std::cerr << "random_sets returns invalid results" << std::endl;
+		return 1;
+	}
+
+	// Container format, with the index cache used in place
+	{
+		char tmpfile_cont[] = "/tmp/leeloo-test-mmap-XXXXXX";
+		close(mkstemp(tmpfile_cont));
+		list_intervals ref_cache(ref);
+		ref_cache.create_index_cache(4);
+		ref_cache.dump_container_to_file(tmpfile_cont);
+
+		list_intervals_mmap lc;
+		lc.map_file(tmpfile_cont, true);
+		unlink(tmpfile_cont);
+		if (!lc.has_index_cache() || (lc.index_cache_entry_size() != 4) || (lc.intervals_count() != ref.intervals_count()) || (lc.size() != ref.size())) {
+			std::cerr << "Mapped container isn't the same as the dumped one!" << std::endl;
+			return 1;
+		}
+		for (uint32_t r = 0; r < ref.size(); r += 7) {
+			if (lc.at_cached(r) != ref.at(r)) {
+				std::cerr << "Invalid value at rank " << r << " in the mapped container" << std::endl;
+				return 1;
+			}
+		}
+
+		// Move
+		list_intervals_mmap lmoved(std::move(lc));
+		if ((lc.intervals_count() != 0) || (lmoved.at_cached(ref.size()-1) != ref.at(ref.size()-1))) {
+			std::cerr << "Invalid move of a mapped list" << std::endl;
+			return 1;
+		}
+	}
+
+	// Containers of non-aggregated lists can't be mapped
+	{
+		char tmpfile_cont[] = "/tmp/leeloo-test-mmap-XXXXXX";
+		close(mkstemp(tmpfile_cont));
+		list_intervals not_aggregated;
+		not_aggregated.add(10, 20);
+		not_aggregated.add(0, 15);
+		not_aggregated.dump_container_to_file(tmpfile_cont);
+
+		bool invalid = false;
+		try {
+			list_intervals_mmap lc;
+			lc.map_file(tmpfile_cont);
+		}
+		catch (leeloo::file_format_exception const&) {
+			invalid = true;
+		}
+		unlink(tmpfile_cont);
+		if (!invalid) {
+			std::cerr << "Non-aggregated container has been mapped!" << std::endl;
+			return 1;
+		}
+	}
+
+	// Empty file
+	char tmpfile_empty[] = "/tmp/leeloo-test-mmap-XXXXXX";
+	fd_tmp = mkstemp(tmpfile_empty);
+	lm.map_fd(fd_tmp);
+	close(fd_tmp);
+	unlink(tmpfile_empty);
+	if ((lm.intervals_count() != 0) || (lm.size() != 0) || lm.contains(0)) {
+		std::cerr << "Mapped empty list isn't empty" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
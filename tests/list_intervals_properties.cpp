@@ -169,6 +169,16 @@ int main()
 		}
 	}
 
+	list2.create_search_index();
+	for (size_t i = 0; i < 25; i++) {
+		property const* ref = list.property_of(i);
+		property const* cmp = list2.property_of(i);
+		if ((ref == nullptr) != (cmp == nullptr) || (ref && (*ref != *cmp))) {
+			std::cerr << "error with search index for " << i << std::endl;
+			ret = 1;
+		}
+	}
+
 	leeloo::list_intervals_with_properties<leeloo::list_intervals<interval>, property> lip;
 	lip.add(0, 2);
 	lip.add(5, 9);
@@ -0,0 +1,105 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include <leeloo/prime_helpers.h>
+
+int main()
+{
+	// Compare with a sieve of Eratosthenes
+	const uint32_t n = 1<<20;
+	std::vector<bool> sieve(n, true);
+	sieve[0] = sieve[1] = false;
+	for (uint32_t i = 2; i*i < n; i++) {
+		if (sieve[i]) {
+			for (uint32_t j = i*i; j < n; j += i) {
+				sieve[j] = false;
+			}
+		}
+	}
+	uint32_t prev = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		if (leeloo::is_prime(i) != sieve[i]) {
+			std::cerr << "is_prime(" << i << ") is invalid!" << std::endl;
+			return 1;
+		}
+		if (sieve[i] && ((i & 3) == 3)) {
+			prev = i;
+		}
+		if (leeloo::find_previous_matching_prime(i) != prev) {
+			std::cerr << "find_previous_matching_prime(" << i << ") is invalid!" << std::endl;
+			return 1;
+		}
+	}
+
+	// Strong pseudoprimes to some of the bases, Carmichael numbers and known
+	// primes around 2^32 and 2^64
+	for (uint64_t const v: {3215031751ULL, 4759123141ULL, 3825123056546413051ULL, 2152302898747ULL, 341550071728321ULL, 1152271ULL*43713001ULL, 4294967297ULL}) {
+		if (leeloo::is_prime(v)) {
+			std::cerr << v << " isn't prime!" << std::endl;
+			return 1;
+		}
+	}
+	for (uint64_t const v: {4294967291ULL, 4294967311ULL, 18446744073709551557ULL, (1ULL<<61)-1}) {
+		if (!leeloo::is_prime(v)) {
+			std::cerr << v << " is prime!" << std::endl;
+			return 1;
+		}
+	}
+	if ((leeloo::find_previous_matching_prime<uint32_t>(0xFFFFFFFF) != 4294967291U) ||
+	    (leeloo::find_next_prime<uint64_t>(0xFFFFFFFF) != 4294967311ULL)) {
+		std::cerr << "Invalid prime search around 2^32!" << std::endl;
+		return 1;
+	}
+
+	// Barrett and Montgomery reductions
+	srand(0);
+	for (uint64_t const m: {3ULL, 4294967291ULL, 4294967311ULL, 281474976710597ULL, 18446744073709551557ULL}) {
+		leeloo::__impl::mod_reducer<uint32_t> red32;
+		leeloo::__impl::mod_reducer<uint64_t> red64;
+		red32.init(m);
+		red64.init(m);
+		for (size_t i = 0; i < 100000; i++) {
+			const uint64_t a = ((((uint64_t) rand()) << 33) ^ (((uint64_t) rand()) << 2) ^ rand()) % m;
+			const uint64_t b = (i == 0) ? m-1 : ((((uint64_t) rand()) << 33) ^ (((uint64_t) rand()) << 2) ^ rand()) % m;
+			if ((m >> 32) == 0 && (red32.mul(a, b) != leeloo::mul_mod<uint64_t>(a, b, m))) {
+				std::cerr << "Invalid Barrett reduction of " << a << "*" << b << " mod " << m << std::endl;
+				return 1;
+			}
+			if (red64.mul(a, b) != leeloo::mul_mod<uint64_t>(a, b, m)) {
+				std::cerr << "Invalid Montgomery reduction of " << a << "*" << b << " mod " << m << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -16,6 +16,10 @@ typedef leeloo::list_intervals<interval, uint32_t> list_intervals;
 typedef leeloo::list_intervals_random<list_intervals, leeloo::uni> list_intervals_random;
 typedef leeloo::list_intervals_random_promise<list_intervals, leeloo::uni> list_intervals_random_promise;
 
+typedef leeloo::interval<uint64_t> interval64;
+typedef leeloo::list_intervals<interval64, uint64_t> list_intervals64;
+typedef leeloo::list_intervals_random<list_intervals64, leeloo::uni> list_intervals_random64;
+
 int main()
 {
 	int ret = 0;
@@ -193,5 +197,35 @@ int main()
 	}
 #endif
 
+	// 64-bit lists wider than 2^32 (IPv4 x ports)
+	list_intervals64 list64;
+	list64.add(interval64(0, 1ULL<<40));
+	list64.add(interval64(1ULL<<47, (1ULL<<48) + 1));
+	list64.aggregate();
+	list64.create_index_cache(32);
+	list_intervals_random64 lir64;
+	lir64.init(list64, leeloo::random_engine<uint64_t>(gen), seed);
+	std::vector<uint64_t> ref64;
+	for (size_t i = 0; i < 10000; i++) {
+		const uint64_t v = lir64(list64);
+		if (!list64.contains(v)) {
+			std::cerr << "64-bit random value " << v << " isn't in the list" << std::endl;
+			ret = 1;
+		}
+		ref64.push_back(v);
+	}
+	lir64.init(list64, leeloo::random_engine<uint64_t>(gen), seed, 5000);
+	for (size_t i = 5000; i < 10000; i++) {
+		if (lir64(list64) != ref64[i]) {
+			std::cerr << "64-bit random values differ with a custom step at " << i << std::endl;
+			ret = 1;
+		}
+	}
+	std::sort(ref64.begin(), ref64.end());
+	if (std::unique(ref64.begin(), ref64.end()) != ref64.end()) {
+		std::cerr << "64-bit random values aren't unique" << std::endl;
+		ret = 1;
+	}
+
 	return ret;
 }
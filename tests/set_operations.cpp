@@ -0,0 +1,146 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+
+#include <leeloo/interval.h>
+#include <leeloo/list_intervals.h>
+
+// Interval of type [a,b[
+typedef leeloo::list_intervals<leeloo::interval<uint32_t>, uint32_t> list_intervals;
+
+template <class Interval>
+void print_intervals(Interval const& l)
+{
+	typedef typename Interval::interval_type interval_type;
+	for (interval_type const& i: l.intervals()) {
+		std::cout << i.lower() << " " << i.upper() << std::endl;
+	}
+}
+
+template <class Interval>
+int compare_intervals(const char* desc, Interval const& l, typename Interval::base_type const* const ref, size_t const ninter)
+{
+	std::cout << desc << std::endl;
+	int ret = 0;
+	if (l.intervals().size() != ninter) {
+		std::cerr << "bad number of intervals" << std::endl;
+		ret = 1;
+	}
+	else {
+		size_t i = 0;
+		for (auto const& it: l.intervals()) {
+			if ((it.lower() != ref[2*i]) ||
+				(it.upper() != ref[2*i+1])) {
+				std::cerr << "invalid interval at index " << i << std::endl;
+				ret = 1;
+			}
+			i++;
+		}
+	}
+	if (ret != 0) {
+		print_intervals(l);
+	}
+	if (!l.is_aggregated()) {
+		std::cerr << "result isn't aggregated" << std::endl;
+		ret = 1;
+	}
+	typename Interval::base_type size(0);
+	for (size_t i = 0; i < ninter; i++) {
+		size += ref[2*i+1]-ref[2*i];
+	}
+	if (l.size() != size) {
+		std::cerr << "bad size" << std::endl;
+		ret = 1;
+	}
+	return ret;
+}
+
+#define COMPARE(desc, l, ...)\
+	{\
+		const uint32_t intervals_ref[] = { __VA_ARGS__ };\
+		ret |= compare_intervals(desc, l, intervals_ref, sizeof(intervals_ref)/(2*sizeof(uint32_t)));\
+	}
+
+int main()
+{
+	int ret = 0;
+
+	list_intervals a;
+	a.add(0, 10);
+	a.add(20, 30);
+	a.add(40, 50);
+	a.aggregate();
+
+	list_intervals b;
+	b.add(5, 25);
+	b.add(30, 40);
+	b.add(45, 60);
+	b.aggregate();
+
+	COMPARE("union", leeloo::set_union(a, b), 0, 60);
+	COMPARE("intersection", leeloo::set_intersection(a, b), 5, 10, 20, 25, 45, 50);
+	COMPARE("difference", leeloo::set_difference(a, b), 0, 5, 25, 30, 40, 45);
+	COMPARE("difference (reverse)", leeloo::set_difference(b, a), 10, 20, 30, 40, 50, 60);
+	COMPARE("symmetric difference", leeloo::set_symmetric_difference(a, b), 0, 5, 10, 20, 25, 45, 50, 60);
+
+	list_intervals empty;
+	COMPARE("union with empty", leeloo::set_union(a, empty), 0, 10, 20, 30, 40, 50);
+	if (leeloo::set_intersection(empty, a).intervals_count() != 0) {
+		std::cerr << "intersection with an empty list should be empty" << std::endl;
+		ret = 1;
+	}
+
+	// Compare the parallel versions with the serial ones on big lists
+	list_intervals big_a, big_b;
+	srand(0);
+	const size_t n = 4*list_intervals::merge_chunk_size;
+	for (size_t i = 0; i < n; i++) {
+		uint32_t x = rand();
+		big_a.add(x, x + (rand()%1000) + 1);
+		x = rand();
+		big_b.add(x, x + (rand()%1000) + 1);
+	}
+	big_a.aggregate();
+	big_b.aggregate();
+
+#define CHECK_PARALLEL(f)\
+	if (leeloo::f<true>(big_a, big_b) != leeloo::f(big_a, big_b)) {\
+		std::cerr << "parallel and serial " #f " differ!" << std::endl;\
+		ret = 1;\
+	}
+
+	CHECK_PARALLEL(set_union);
+	CHECK_PARALLEL(set_intersection);
+	CHECK_PARALLEL(set_difference);
+	CHECK_PARALLEL(set_symmetric_difference);
+
+	return ret;
+}
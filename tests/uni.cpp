@@ -28,17 +28,19 @@
 
 #include <iostream>
 #include <ctime>
+#include <memory>
 
 #include <leeloo/helpers.h>
 #include <leeloo/bench.h>
 #include <leeloo/uni.h>
 #include <leeloo/random.h>
 
-bool check(std::vector<uint32_t>& res, const size_t n)
+template <class Integer>
+bool check(std::vector<Integer>& res, const size_t n)
 {
 	std::sort(res.begin(), res.end());
 	auto it_end = std::unique(res.begin(), res.end());
-	uint32_t v = 0;
+	Integer v = 0;
 
 	bool ret = true;
 
@@ -58,6 +60,43 @@ bool check(std::vector<uint32_t>& res, const size_t n)
 	return ret;
 }
 
+// fill() must give the same integers as uni<uint32_t> with the same random
+// engine, including when its sizes aren't multiples of the vector size
+template <class Uni>
+bool check_fill(const size_t n, uint32_t const seed)
+{
+	boost::random::mt19937 gen_ref(seed);
+	leeloo::uni<uint32_t> ref;
+	ref.init(n, leeloo::random_engine<uint32_t>(gen_ref));
+
+	boost::random::mt19937 gen(seed);
+	// On the heap, whose allocations aren't aligned on vector sizes before
+	// C++17
+	std::unique_ptr<Uni> puni(new Uni);
+	Uni& uni = *puni;
+	uni.init(n, leeloo::random_engine<uint32_t>(gen));
+
+	std::vector<uint32_t> res;
+	res.resize(n);
+	size_t chunk = 1;
+	for (size_t i = 0; i < n; i += chunk, chunk = 2*chunk + 1) {
+		uni.fill(&res[i], std::min(chunk, n-i));
+	}
+	for (size_t i = 0; i < n; i++) {
+		if (res[i] != ref()) {
+			std::cerr << "Error: fill() differs from uni<uint32_t> at " << i << std::endl;
+			return false;
+		}
+	}
+	return check(res, n);
+}
+
+template <class Uni>
+bool check_fill(const size_t n)
+{
+	return check_fill<Uni>(n, time(NULL)) && check_fill<Uni>(100003, time(NULL));
+}
+
 int main(int argc, char** argv)
 {
 	size_t n = (argc > 1) ? atoll(argv[1]) : 20;
@@ -94,7 +133,7 @@ int main(int argc, char** argv)
 #endif
 
 #ifdef __SSE4_2__
-	leeloo::uni<__m128i> uni_sse;
+	leeloo::uni<leeloo::sse42_lanes> uni_sse;
 	uni_sse.init(n, leeloo::random_engine<uint32_t>(gen));
 
 	memset(&res[0], 0, sizeof(uint32_t)*n);
@@ -127,5 +166,61 @@ int main(int argc, char** argv)
 #endif
 #endif
 
+	using namespace leeloo::cpu_features;
+	if (!check_fill<leeloo::uni_dispatch>(n) ||
+	    (supports(simd_sse42) && !check_fill<leeloo::uni<leeloo::sse42_lanes>>(n)) ||
+	    (supports(simd_avx2) && !check_fill<leeloo::uni<leeloo::avx2_lanes>>(n)) ||
+	    (supports(simd_avx512) && !check_fill<leeloo::uni<leeloo::avx512_lanes>>(n))) {
+		return 1;
+	}
+
+	// uni_dispatch held by a heap-allocated object, as done by its users
+	{
+		std::vector<std::unique_ptr<leeloo::uni_dispatch>> unis;
+		for (size_t i = 0; i < 8; i++) {
+			unis.emplace_back(new leeloo::uni_dispatch);
+			unis.back()->init(1000000, leeloo::random_engine<uint32_t>(gen));
+			uint32_t buf[100];
+			unis.back()->fill(buf, 100);
+		}
+	}
+
+	// 64-bit integers, with an engine created for 32-bit integers
+	leeloo::uni<uint64_t> uni64;
+	uni64.init(n, leeloo::random_engine<uint32_t>(gen));
+	std::vector<uint64_t> res64;
+	res64.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		res64[i] = uni64();
+	}
+	if (!check(res64, n)) {
+		return 1;
+	}
+
+	// Space wider than 2^32 (IPv4 x ports)
+	const uint64_t max64 = (1ULL<<48) + 12345;
+	const size_t n64 = 1<<16;
+	uni64.init(max64, leeloo::random_engine<uint64_t>(gen));
+	res64.resize(n64);
+	bool above32 = false;
+	for (size_t i = 0; i < n64; i++) {
+		const uint64_t next = uni64.get_step(0);
+		res64[i] = uni64();
+		if (res64[i] >= max64) {
+			std::cerr << "Error: " << res64[i] << " is out of [0," << max64 << "[" << std::endl;
+			return 1;
+		}
+		if (res64[i] != next) {
+			std::cerr << "Error: get_step differs from the serial generator at " << i << std::endl;
+			return 1;
+		}
+		above32 |= (res64[i] >> 32) != 0;
+	}
+	std::sort(res64.begin(), res64.end());
+	if ((std::unique(res64.begin(), res64.end()) != res64.end()) || !above32) {
+		std::cerr << "Error: 64-bit numbers aren't unique or aren't spread over the space!" << std::endl;
+		return 1;
+	}
+
 	return 0;
 }
@@ -0,0 +1,64 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <leeloo/bench.h>
+#include <leeloo/random.h>
+#include <leeloo/uni.h>
+
+template <class Integer>
+static void bench_init(Integer const max, size_t const reps, boost::random::mt19937& gen)
+{
+	leeloo::uni<Integer> uni;
+	BENCH_START(init);
+	for (size_t i = 0; i < reps; i++) {
+		// Use different domains so that the prime search isn't always the same
+		uni.init(max - 2*(i % 64), leeloo::random_engine<Integer>(gen));
+	}
+	BENCH_END_NODISP(init);
+	fprintf(stderr, "uni<uint%lu_t>::init(%lu): %0.3f us\n", sizeof(Integer)*8, (size_t) max, BENCH_END_TIME(init)*1000000.0/reps);
+}
+
+int main(int argc, char** argv)
+{
+	const size_t reps = (argc > 1) ? atoll(argv[1]) : 100;
+
+	boost::random::mt19937 gen(time(NULL));
+	for (unsigned int bits: {8, 16, 24, 31, 32}) {
+		bench_init<uint32_t>((uint32_t) ((1ULL<<bits) - 1), reps, gen);
+	}
+	for (unsigned int bits: {40, 48, 56, 63, 64}) {
+		bench_init<uint64_t>((bits == 64) ? UINT64_MAX : ((1ULL<<bits) - 1), reps, gen);
+	}
+
+	return 0;
+}
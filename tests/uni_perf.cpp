@@ -0,0 +1,101 @@
+/* 
+ * Copyright (c) 2013-2014, Quarkslab
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * - Neither the name of Quarkslab nor the names of its contributors may be used
+ * to endorse or promote products derived from this software without specific
+ * prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include <leeloo/bench.h>
+#include <leeloo/random.h>
+#include <leeloo/uni.h>
+
+template <class Integer>
+static void bench_scalar(const char* desc, Integer const max, size_t const n, boost::random::mt19937& gen)
+{
+	leeloo::uni<Integer> uni;
+	uni.init(max, leeloo::random_engine<Integer>(gen));
+	Integer sum = 0;
+	BENCH_START(scalar);
+	for (size_t i = 0; i < n; i++) {
+		sum += uni();
+	}
+	BENCH_END_NODISP(scalar);
+	fprintf(stderr, "%s: %0.2f Mvalues/s (sum %lu)\n", desc, n/(BENCH_END_TIME(scalar)*1000000.0), (size_t) sum);
+}
+
+template <class Uni>
+static void bench_fill(const char* desc, uint32_t const max, size_t const n, boost::random::mt19937& gen)
+{
+	Uni uni;
+	uni.init(max, leeloo::random_engine<uint32_t>(gen));
+	std::vector<uint32_t> buf;
+	buf.resize(n);
+	BENCH_START(fill);
+	uni.fill(&buf[0], n);
+	BENCH_END_NODISP(fill);
+	fprintf(stderr, "%s: %0.2f Mvalues/s (first %u)\n", desc, n/(BENCH_END_TIME(fill)*1000000.0), buf[0]);
+}
+
+int main(int argc, char** argv)
+{
+	const size_t n = (argc > 1) ? atoll(argv[1]) : (1<<24);
+
+	boost::random::mt19937 gen(time(NULL));
+	bench_scalar<uint32_t>("uni<uint32_t>", 0xFFFFFFF0U, n, gen);
+	bench_scalar<uint64_t>("uni<uint64_t>", 1ULL<<48, n, gen);
+	bench_scalar<uint64_t>("uni<uint64_t> (near 2^64)", 0xFFFFFFFFFFFFFFF0ULL, n, gen);
+
+#ifdef __SSE4_2__
+	leeloo::uni<leeloo::sse42_lanes> uni_sse;
+	// The SSE version compares positions as signed integers
+	uni_sse.init(0x7FFFFFF0U, leeloo::random_engine<uint32_t>(gen));
+	__m128i sum = _mm_setzero_si128();
+	BENCH_START(sse);
+	for (size_t i = 0; i < n/4; i++) {
+		sum = _mm_add_epi32(sum, uni_sse());
+	}
+	BENCH_END_NODISP(sse);
+	fprintf(stderr, "uni<sse42_lanes>: %0.2f Mvalues/s (sum %u)\n", (n & ~((size_t) 3))/(BENCH_END_TIME(sse)*1000000.0), (uint32_t) _mm_extract_epi32(sum, 0));
+#endif
+
+	using namespace leeloo::cpu_features;
+	if (supports(simd_sse42)) {
+		bench_fill<leeloo::uni<leeloo::sse42_lanes>>("uni<sse42_lanes>::fill", 0x7FFFFFF0U, n, gen);
+	}
+	if (supports(simd_avx2)) {
+		bench_fill<leeloo::uni<leeloo::avx2_lanes>>("uni<avx2_lanes>::fill", 0xFFFFFFF0U, n, gen);
+	}
+	if (supports(simd_avx512)) {
+		bench_fill<leeloo::uni<leeloo::avx512_lanes>>("uni<avx512_lanes>::fill", 0xFFFFFFF0U, n, gen);
+	}
+	bench_fill<leeloo::uni_dispatch>("uni_dispatch::fill", 0xFFFFFFF0U, n, gen);
+
+	return 0;
+}
@@ -26,50 +26,124 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <x86intrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 #include <string.h>
 
+#include <tbb/task_scheduler_init.h>
+
+#include <algorithm>
 #include <iostream>
-#include <fstream>
-#include <memory>
+#include <vector>
 
+#include <leeloo/helpers.h>
 #include <leeloo/ip_list_intervals.h>
+#include <leeloo/ips_writer.h>
+
+// Size of the blocks read from non-mappable inputs (pipes, ...)
+static constexpr size_t read_block_size = 64*1024*1024;
+
+namespace {
 
-static inline const char* ip2str(uint32_t ip)
+// Parse all the lines of [buf, buf+size[ in parallel. The last line doesn't
+// need to end with a new line.
+void parse_block(const char* const buf, size_t const size, leeloo::ip_list_intervals& l, size_t& lines)
 {
-	ip = htonl(ip);
-	return inet_ntoa(*reinterpret_cast<struct in_addr const*>(&ip));
+	for (size_t offset: l.add_many(buf, size, '\n')) {
+		const char* const line = buf + offset;
+		const char* const nl = (const char*) memchr(line, '\n', size - offset);
+		std::cerr << "Warning: unable to parse '";
+		std::cerr.write(line, (nl == nullptr) ? (size - offset) : (nl - line));
+		std::cerr << "'. Ignoring..." << std::endl;
+	}
+	lines += std::count(buf, buf + size, '\n');
+	if (buf[size-1] != '\n') {
+		lines++;
+	}
 }
 
-static void display(leeloo::ip_interval const& it)
+// Parse the whole file in place if it can be mapped
+bool parse_mapped(int const fd, leeloo::ip_list_intervals& l, size_t& lines)
 {
-	const uint32_t width = it.width();
-	const char* ip_a = ip2str(it.lower());
-	if (__builtin_popcount(width) == 1) {
-		// CIDR prefix
-		const int prefix = 32-__builtin_ctz(width);
-		std::cout << ip_a << "/" << prefix << std::endl;
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode)) {
+		return false;
 	}
-	else {
-		// AG: as a static buffer is used for inet_ntoa, we need to make two
-		// std::cout statements here, or the same IP will be shown twice!
-		std::cout << ip_a << "-"; 
-		std::cout << ip2str(it.upper()) << std::endl;
+	const size_t size = st.st_size;
+	if (size == 0) {
+		return true;
 	}
+	void* const map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	madvise(map, size, MADV_SEQUENTIAL);
+	parse_block((const char*) map, size, l, lines);
+	munmap(map, size);
+	return true;
+}
+
+// Read the input by large blocks, and parse each of them in parallel
+bool parse_blocks(int const fd, leeloo::ip_list_intervals& l, size_t& lines)
+{
+	std::vector<char> buf;
+	buf.resize(read_block_size);
+	// Number of bytes of buf that are filled
+	size_t filled = 0;
+	bool eof = false;
+	while (!eof) {
+		if (filled == buf.size()) {
+			// A line is longer than the buffer
+			buf.resize(2*buf.size());
+		}
+		const ssize_t r = read(fd, &buf[filled], buf.size() - filled);
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		filled += r;
+		eof = (r == 0);
+
+		// Parse up to the last complete line, or everything at the end
+		size_t parsed = filled;
+		if (!eof) {
+			const char* const last_nl = (const char*) memrchr(&buf[0], '\n', filled);
+			if (last_nl == nullptr) {
+				continue;
+			}
+			parsed = (last_nl - &buf[0]) + 1;
+		}
+		if (parsed > 0) {
+			parse_block(&buf[0], parsed, l, lines);
+		}
+		memmove(&buf[0], &buf[parsed], filled - parsed);
+		filled -= parsed;
+	}
+	return true;
+}
+
 }
 
 static void usage(const char* path)
 {
-	std::cerr << "Usage: " << path << " [--help] [--max-prefix max_prefix] [input_file]" << std::endl;
+	std::cerr << "Usage: " << path << " [--help] [--max-prefix max_prefix] [--threads n] [--cidr|--ranges] [input_file]" << std::endl;
 	std::cerr << "where:\n" << std::endl;
 	std::cerr << "\t--help: show this help" << std::endl;
 	std::cerr << "\t--max-prefix: aggregate with a maximum prefix (1 <= prefix <= 32)" << std::endl;
+	std::cerr << "\t--threads: number of threads to use (defaults to the number of cores)" << std::endl;
+	std::cerr << "\t--cidr: write each range as its set of CIDR blocks" << std::endl;
+	std::cerr << "\t--ranges: write each range as first-last, where last is included" << std::endl;
 	std::cerr << "\t[input_file] is a list of IPs ranges (defaults to stdin)\n" << std::endl;
 
+	std::cerr << "By default, ranges whose size is a power of two are written as first/prefix, and" << std::endl;
+	std::cerr << "the others as first-end, where end is excluded.\n" << std::endl;
+
 	std::cerr << "IP ranges can be defined as:\n" << std::endl;
 	std::cerr << "\tSingle IP:     192.168.0.1" << std::endl;
 	std::cerr << "\tCIDR notation: 192.168.4.0/24" << std::endl;
@@ -79,9 +153,10 @@ static void usage(const char* path)
 
 int main(int argc, char** argv)
 {
-	std::istream* in = &std::cin; 
-	std::unique_ptr<std::ifstream> in_storage;
+	int fd = STDIN_FILENO;
 	int max_prefix = -1;
+	int threads = tbb::task_scheduler_init::automatic;
+	enum { output_legacy, output_cidr, output_ranges } output = output_legacy;
 	for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "--max-prefix") == 0) {
 			i++;
@@ -95,35 +170,60 @@ int main(int argc, char** argv)
 			}
 		}
 		else
+		if (strcmp(argv[i], "--threads") == 0) {
+			i++;
+			if (i >= argc) {
+				break;
+			}
+			threads = atoi(argv[i]);
+			if (threads <= 0) {
+				std::cerr << "Number of threads must be positive." << std::endl;
+				return 1;
+			}
+		}
+		else
+		if (strcmp(argv[i], "--cidr") == 0) {
+			output = output_cidr;
+		}
+		else
+		if (strcmp(argv[i], "--ranges") == 0) {
+			output = output_ranges;
+		}
+		else
 		if (strcmp(argv[i], "--help") == 0) {
 			usage(argv[0]);
 			return 1;
 		}
 		else {
-			if (in != &std::cin) {
+			if (fd != STDIN_FILENO) {
 				usage(argv[0]);
 				return 1;
 			}
 			const char* file = argv[i];
-			std::unique_ptr<std::ifstream> f(new std::ifstream(file, std::ifstream::in));
-			if (!(*f)) {
+			fd = open(file, O_RDONLY);
+			if (fd == -1) {
 				std::cerr << "Error opening " << file << ": " << strerror(errno) << std::endl;
 				return errno;
 			}
-			in = f.get();
-			in_storage = std::move(f);
 		}
 	}
 
-	leeloo::ip_list_intervals l;
+	tbb::task_scheduler_init init(threads);
 
-	std::string line;
-	while (std::getline(*in, line)) {
-		if (!l.add(line.c_str())) {
-			std::cerr << "Warning: unable to parse '" << line << "'. Ignoring..." << std::endl;
-		}
+	const double start = leeloo::get_current_timestamp();
+
+	leeloo::ip_list_intervals l;
+	size_t lines = 0;
+	if (!parse_mapped(fd, l, lines) && !parse_blocks(fd, l, lines)) {
+		std::cerr << "Error reading input: " << strerror(errno) << std::endl;
+		return errno;
+	}
+	if (fd != STDIN_FILENO) {
+		close(fd);
 	}
 
+	const double parsed = leeloo::get_current_timestamp();
+
 	if (max_prefix == -1) {
 		l.aggregate();
 	}
@@ -131,9 +231,31 @@ int main(int argc, char** argv)
 		l.aggregate_max_prefix(max_prefix);
 	}
 
-	for (leeloo::ip_interval const& it: l) {
-		display(it);
+	const double aggregated = leeloo::get_current_timestamp();
+
+	try {
+		switch (output) {
+			case output_cidr:
+				leeloo::ips_writer::write_cidr(STDOUT_FILENO, l);
+				break;
+			case output_ranges:
+				leeloo::ips_writer::write_ranges(STDOUT_FILENO, l);
+				break;
+			default:
+				leeloo::ips_writer::write_legacy(STDOUT_FILENO, l);
+				break;
+		}
 	}
+	catch (leeloo::file_exception const& e) {
+		std::cerr << "Error writing output: " << e.what() << std::endl;
+		return 1;
+	}
+
+	const double end = leeloo::get_current_timestamp();
+	const double total = end - start;
+	std::cerr << lines << " lines parsed in " << (parsed - start) << " s, aggregated in " << (aggregated - parsed)
+	          << " s, written in " << (end - aggregated) << " s: " << (size_t) (total > 0 ? lines/total : 0)
+	          << " lines/s." << std::endl;
 
 	return 0;
 }
@@ -75,7 +75,8 @@ int main(int argc, char** argv)
 
 	std::cerr << "Number of IPs after aggregation: " << l.size() << std::endl;
 
-	l.create_index_cache(256);
+	const size_t cache_entry_size = l.create_index_cache();
+	std::cerr << "Index cache: one entry every " << cache_entry_size << " intervals, " << l.index_cache_memory_size() << " bytes." << std::endl;
 
 	// Initialize a random generator
 	boost::random::mt19937 mt_rand(time(NULL));